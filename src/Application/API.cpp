@@ -3,10 +3,11 @@
 
 namespace API {
     auto StartHyperFlush::operator()(App & app) -> R {
-        decltype(auto) hyperFlushName = app.hyperFlushStateController.getCurrentState()->getName();
-
         R response;
-        if (strcmp(HyperFlush::IDLE, hyperFlushName) == 0) {
+        if (app.currentTaskId) {
+            // Preloading turns pumps on and off across the whole unit
+            response["error"] = "Cannot preload water while a task is running";
+        } else if (app.hyperFlushStateController.isIdle()) {
             println("Begin hyperflush");
             app.beginHyperFlush();
             response["success"] = "Begin preloading water";
@@ -17,6 +18,28 @@ namespace API {
         return response;
     }
 
+    auto StartNowTask::operator()(Arg<0> & app, Arg<1> & input) -> R {
+        const unsigned long requestedAt = millis();
+
+        R response;
+        if (!input[TaskKeys::ID].is<int>()) {
+            response["error"] = "Missing task id";
+            return response;
+        }
+
+        int id = input[TaskKeys::ID];
+        app.validateTaskForStarting(id, response);
+        if (response.containsKey("error")) {
+            return response;
+        }
+
+        app.startTaskNow(id, requestedAt);
+
+        response["success"] = "Task started";
+        response["latency"] = app.status.taskStartLatency;
+        return response;
+    }
+
     auto StatusGet::operator()(App & app) -> R {
         R response;
         encodeJSON(app.status, response.to<JsonObject>());
@@ -24,6 +47,142 @@ namespace API {
         return response;
     }
 
+    auto PlanGet::operator()(App & app) -> R {
+        R response;
+        const TaskPlanner::Plan plan = app.planActiveTasks();
+
+        using namespace PlanKeys;
+        response[BEGIN]   = plan.begin;
+        response[END]     = plan.end;
+        response[PUMP_ON] = plan.pumpOnSeconds;
+
+        // Compact rows: [taskId, valve, start, end]
+        JsonArray valves = response.createNestedArray(VALVES);
+        for (const auto & window : plan.valves) {
+            JsonArray row = valves.createNestedArray();
+            row.add(window.taskId);
+            row.add(window.valve);
+            row.add(window.start);
+            row.add(window.end);
+        }
+
+        // Windows where no pump runs and the radio is free: [start, end]
+        JsonArray idle = response.createNestedArray(IDLE);
+        for (const auto & window : plan.idle) {
+            JsonArray row = idle.createNestedArray();
+            row.add(window.start);
+            row.add(window.end);
+        }
+
+        JsonArray missed = response.createNestedArray(MISSED);
+        for (auto id : plan.missed) {
+            missed.add(id);
+        }
+
+        return response;
+    }
+
+    auto TraceGet::operator()(App & app) -> R {
+        R response;
+        using namespace TraceKeys;
+        response[DROPPED] = app.trace.numberOfDroppedEvents();
+
+        // Compact rows, oldest first: [millis, machine, from, to, code, valve]
+        JsonArray events = response.createNestedArray(EVENTS);
+        app.trace.forEach([&events](const TransitionEvent & e) {
+            JsonArray row = events.createNestedArray();
+            row.add(e.time);
+            row.add(int(e.machine));
+            row.add(int(e.from));
+            row.add(e.to);
+            row.add(e.code);
+            row.add(e.valve);
+        });
+
+        return response;
+    }
+
+    auto ProfileGet::operator()(App & app) -> R {
+        R response;
+        using namespace ProfileKeys;
+        response[DROPPED] = app.profiler.numberOfDroppedRecords();
+
+        // Phase name -> [count, panics, configured ms, actual ms, mean overrun ms,
+        // max overrun ms, mean latency ms, max latency ms]
+        JsonObject phases = response.createNestedObject(PHASES);
+        for (uint8_t type = 0; type < Phase::count; type++) {
+            const auto & a = app.profiler.aggregate(Phase::Type(type));
+            if (!a.count) {
+                continue;
+            }
+
+            JsonArray row = phases.createNestedArray(Phase::name(Phase::Type(type)));
+            row.add(a.count);
+            row.add(a.panics);
+            row.add(a.configured);
+            row.add(a.actual);
+            row.add(a.meanOverrun());
+            row.add(a.maxOverrun);
+            row.add(a.meanLatency());
+            row.add(a.maxLatency);
+        }
+
+        // Newest records, oldest first: [valve, phase, configured s, actual ms, latency ms, code]
+        JsonArray recent = response.createNestedArray(RECENT);
+        app.profiler.forEach(ProfileSettings::SERVED, [&recent](const PhaseRecord & r) {
+            JsonArray row = recent.createNestedArray();
+            row.add(r.valve);
+            row.add(r.type);
+            row.add(r.configured);
+            row.add(r.actual);
+            row.add(r.latency);
+            row.add(r.code);
+        });
+
+        return response;
+    }
+
+    auto MetricsGet::operator()(App & app) -> R {
+        R response;
+        using namespace MetricsKeys;
+        const I2CMetrics & metrics = app.pwm.metrics;
+        response[I2C_CLOCK]    = app.config.i2cClock;
+        response[TRANSACTIONS] = metrics.transactions;
+        response[RETRIES]      = metrics.retries;
+        response[NACKS]        = metrics.nacks;
+        response[TIMEOUTS]     = metrics.timeouts;
+        response[FAILURES]     = metrics.failures;
+        response[SKIPPED]      = metrics.skipped;
+
+        // Bin i counts transactions shorter than edges[i] µs, the last one the rest
+        JsonArray edges     = response.createNestedArray(LATENCY_EDGES);
+        JsonArray histogram = response.createNestedArray(LATENCY_HISTOGRAM);
+        for (size_t i = 0; i < I2CMetrics::BINS; i++) {
+            if (i < I2CMetrics::BINS - 1) {
+                edges.add(I2CMetrics::upperEdge(i));
+            }
+
+            histogram.add(metrics.histogram[i]);
+        }
+
+        response[SHUTDOWN_LATENCY]     = app.pwm.shutdownLatency;
+        response[MAX_SHUTDOWN_LATENCY] = app.pwm.maxShutdownLatency;
+        response[ACTUATION_SKEW]       = (unsigned long) app.actuator.lastSkew;
+        response[MAX_ACTUATION_SKEW]   = (unsigned long) app.actuator.maxSkew;
+        response[PENDING_ACTUATIONS]   = app.actuator.numberOfPendingCommands();
+        response[CONTROL_OUTPUT]       = app.flowController.output;
+        response[CONTROL_TICKS]        = app.flowController.ticks;
+        response[CONTROL_JITTER]       = app.flowController.jitter;
+        response[MAX_CONTROL_JITTER]   = app.flowController.maxJitter;
+        response[MISSED_CONTROL_TICKS] = app.flowController.missedTicks;
+        response[CUTOFF_PRESSURE]      = app.guard.threshold;
+        response[CUTOFF_EVENTS]        = app.guard.events;
+        response[CUTOFF_LATENCY]       = app.guard.latency;
+        response[MAX_CUTOFF_LATENCY]   = app.guard.maxLatency;
+        response[MAX_CUTOFF_BLIND]     = (unsigned long) app.guard.maxBlindTime;
+        return response;
+    }
+
     auto ConfigGet::operator()(App & app) -> R {
         R response;
         encodeJSON(app.config, response.to<JsonObject>());
@@ -123,6 +282,7 @@ namespace API {
 
         Task & task           = app.tm.tasks[id];
         task.valveOffsetStart = 0;
+        task.anchorRecurrence();
         app.tm.setTaskStatus(task.id, TaskStatus::active);
         app.tm.writeToDirectory();
 
@@ -174,7 +334,9 @@ namespace API {
         // Checking against compiled time + millis() to prevents bogus value
         if (utc >= compileTime + millisToSecs(millis())) {
             response["success"] = "RTC updated";
+            app.power.utcDidSync(utc + 1);
             app.power.set(utc + 1);
+            app.saveClockDrift();
         } else {
             response["error"] = "That doesn't seem right.";
         }
@@ -26,14 +26,30 @@ namespace API {
         auto operator()(Arg<0>) -> R;
     };
 
-    struct StartNowTask : APISpec<JsonResponse<300>(App &)> {
-        auto operator()(Arg<0>) -> R;
+    struct StartNowTask : APISpec<JsonResponse<300>(App &, JsonDocument &)> {
+        auto operator()(Arg<0>, Arg<1>) -> R;
     };
 
     struct StatusGet : APISpec<JsonResponse<Status::encodingSize()>(App &)> {
         auto operator()(Arg<0>) -> R;
     };
 
+    struct PlanGet : APISpec<JsonResponse<ProgramSettings::PLAN_JSON_BUFFER_SIZE>(App &)> {
+        auto operator()(Arg<0>) -> R;
+    };
+
+    struct TraceGet : APISpec<JsonResponse<ProgramSettings::TRACE_JSON_BUFFER_SIZE>(App &)> {
+        auto operator()(Arg<0>) -> R;
+    };
+
+    struct ProfileGet : APISpec<JsonResponse<ProgramSettings::PROFILE_JSON_BUFFER_SIZE>(App &)> {
+        auto operator()(Arg<0>) -> R;
+    };
+
+    struct MetricsGet : APISpec<JsonResponse<ProgramSettings::METRICS_JSON_BUFFER_SIZE>(App &)> {
+        auto operator()(Arg<0>) -> R;
+    };
+
     struct ConfigGet : APISpec<JsonResponse<Config::encodingSize()>(App &)> {
         auto operator()(Arg<0>) -> R;
     };
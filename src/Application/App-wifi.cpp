@@ -1,7 +1,7 @@
 #include <Application/App.hpp>
 
 void App::setupServerRouting() {
-  server.handlers.reserve(13);
+  server.handlers.reserve(19);
 
     server.get("/", [this](Request & req, Response & res) {
       println(F("Sending UI"));
@@ -35,6 +35,59 @@ void App::setupServerRouting() {
         serializeJsonPretty(response, Serial);
     });
 
+    // ────────────────────────────────────────────────────────────────────────────────
+    // Predict the execution timeline of all active tasks
+    // ────────────────────────────────────────────────────────────────────────────────
+    server.get("/api/plan", [this](Request &, Response & res) {
+        const auto & response = dispatchAPI<API::PlanGet>();
+
+        KPStringBuilder<10> length(measureJson(response));
+        res.setHeader("Content-Length", length);
+        res.json(response);
+        res.end();
+    });
+
+    // ────────────────────────────────────────────────────────────────────────────────
+    // Last state transitions of the state machines
+    // ────────────────────────────────────────────────────────────────────────────────
+    server.get("/api/trace", [this](Request &, Response & res) {
+        const auto & response = dispatchAPI<API::TraceGet>();
+
+        KPStringBuilder<10> length(measureJson(response));
+        res.setHeader("Content-Length", length);
+        res.json(response);
+        res.end();
+    });
+
+    // ────────────────────────────────────────────────────────────────────────────────
+    // Planned-vs-actual phase timings
+    // ────────────────────────────────────────────────────────────────────────────────
+    server.get("/api/profile", [this](Request &, Response & res) {
+        const auto & response = dispatchAPI<API::ProfileGet>();
+
+        KPStringBuilder<10> length(measureJson(response));
+        res.setHeader("Content-Length", length);
+        res.json(response);
+        res.end();
+    });
+
+    server.get("/api/profile/reset", [this](Request &, Response & res) {
+        profiler.reset();
+        res.end();
+    });
+
+    // ────────────────────────────────────────────────────────────────────────────────
+    // I2C bus health of the PWM drivers
+    // ────────────────────────────────────────────────────────────────────────────────
+    server.get("/api/metrics", [this](Request &, Response & res) {
+        const auto & response = dispatchAPI<API::MetricsGet>();
+
+        KPStringBuilder<10> length(measureJson(response));
+        res.setHeader("Content-Length", length);
+        res.json(response);
+        res.end();
+    });
+
         // ────────────────────────────────────────────────────────────────────────────────
     // Get a list of valve objects
     // ────────────────────────────────────────────────────────────────────────────────
@@ -114,6 +167,26 @@ void App::setupServerRouting() {
         res.end();
     });
 
+    // ────────────────────────────────────────────────────────────────────────────────
+    // Start a task immediately
+    // ────────────────────────────────────────────────────────────────────────────────
+    server.post("/api/task/start", [this](Request & req, Response & res) {
+        StaticJsonDocument<100> body;
+        if (const DeserializationError error = deserializeJson(body, req.body)) {
+            StaticJsonDocument<100> response;
+            response["error"] = error.c_str();
+            res.json(response);
+            res.end();
+            return;
+        }
+
+        serializeJsonPretty(body, Serial);
+
+        const auto & response = dispatchAPI<API::StartNowTask>(body);
+        res.json(response);
+        res.end();
+    });
+
     // ────────────────────────────────────────────────────────────────────────────────
     // Unschedule a task (making it inactive)
     // ────────────────────────────────────────────────────────────────────────────────
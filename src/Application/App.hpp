@@ -5,14 +5,25 @@
 #include <KPController.hpp>
 #include <KPFileLoader.hpp>
 #include <KPServer.hpp>
+#include <WiFi101.h>
 #include <Action.hpp>
 #include <Application/Status.hpp>
+#include <Application/TransitionTrace.hpp>
+#include <Application/PhaseProfiler.hpp>
 #include <Application/Constants.hpp>
 
 #include <Application/ScheduleReturnCode.hpp>
 
 #include <Components/Power.hpp>
+#include <Components/DeadlineScheduler.hpp>
 #include <Components/PWMDriver.hpp>
+#include <Components/Actuator.hpp>
+#include <Components/PumpArbiter.hpp>
+#include <Components/FlowCalibration.hpp>
+#include <Components/FlowEstimator.hpp>
+#include <Components/FlowController.hpp>
+#include <Components/OverpressureGuard.hpp>
+#include <Components/PreservationPipeline.hpp>
 
 #include <Valve/Valve.hpp>
 #include <Valve/ValveManager.hpp>
@@ -23,6 +34,7 @@
 #include <StateControllers/HyperFlushStateController.hpp>
 #include <Task/Task.hpp>
 #include <Task/TaskManager.hpp>
+#include <Task/TaskPlanner.hpp>
 
 #include <Application/API.hpp>
 
@@ -43,27 +55,42 @@ private:
       }
   }
 
-  void taskDidComplete() override {}
+  void taskDidComplete(const Task & task) override {
+      // Only a task that ran to completion chains, not one being unscheduled
+      if (task.id == currentTaskId && task.successor && task.getNumberOfValves()) {
+          pendingSuccessorId = task.successor;
+      }
+  }
 public:
-  unsigned long workaroundTaskSchedule;
-  bool taskToRun;
   KPFileLoader fileLoader{"file-loader", 10}; //SDCS is 10 for Atmel M0
   KPServer server{"web-server", "subsampler", "ilab_sampler"};
 
   Power power{"power"};
-  PWMDriver pwm{"pwm-driver", 16}; 
+  PWMDriver pwm{"pwm-driver", PumpSettings::CHANNELS};
+  Actuator actuator{pwm};
+  PumpArbiter pumps{"pump-arbiter", pwm, actuator};
+  PreservationPipeline pipeline{"preservation-pipeline", pumps};
   Config config{ProgramSettings::CONFIG_FILE_PATH};
   Status status;
+  FlowCalibration calibration;
+  FlowEstimator flow{"flow-estimator", calibration, pumps, status};
+  TransitionTrace trace{status.currentValves};
+  PhaseProfiler profiler{status.currentValves};
 
   TaskStateController taskStateController;
   HyperFlushStateController hyperFlushStateController;
 
   PressureSensor pressureSensor{"pressure-sensor"};
+  FlowController flowController{"flow-controller", pumps, pressureSensor, status};
+  OverpressureGuard guard{"overpressure-guard", pumps, actuator, pressureSensor};
 
   ValveManager vm;
   TaskManager tm;
 
   int currentTaskId = 0;
+  int pendingSuccessorId = 0;
+  // millis() since the unit has been waiting for a scheduled task with nothing to do
+  unsigned long idleSince = 0;
 
 
   template <typename T, typename... Args>
@@ -73,7 +100,6 @@ public:
 
   
   void setup() override {
-    taskToRun = false;
     Serial.begin(115200);
     delay(3000);
     //while(!Serial) {};
@@ -83,7 +109,10 @@ public:
     setupServerRouting();
 
     //Unclear if this is needed with both RTC and PWM driver(s) using I2C
-    Wire.begin();
+    {
+        I2CBus::Lock lock;
+        Wire.begin();
+    }
 
     addComponent(power);
     randomSeed(now());
@@ -92,6 +121,9 @@ public:
     addComponent(fileLoader);
 
     addComponent(pwm);
+    addComponent(pumps);
+    addComponent(flow);
+    addComponent(pipeline);
 
     //
     // ─── LOADING CONFIG FILE ─────────────────────────────────────────
@@ -99,7 +131,14 @@ public:
     // Load configuration from file to initialize config and status objects
     JsonFileLoader loader;
     loader.load(config.configFilepath, config);
+    power.drift.rtcOffset = config.rtcOffset;
+    loader.load(ClockSettings::FILE, power.drift);
+    power.applyCalibration();
+    loader.load(FlowSettings::FILE, calibration);
     status.init(config);
+    pumps.init(config);
+    flowController.init(config);
+    guard.init(config);
 
     vm.init(config);
     vm.addObserver(status);
@@ -109,8 +148,9 @@ public:
     tm.addObserver(this);
     tm.loadTasksFromDirectory(config.taskFolder);
 
-    hyperFlushStateController.configure([](HyperFlush::Config & config) {
-        config.preloadTime = 30;
+    hyperFlushStateController.configure([this](HyperFlush::Config & hyperFlushConfig) {
+        hyperFlushConfig.preloadTime        = 30;
+        hyperFlushConfig.preloadParallelism = config.preloadParallelism;
     });
 
     addComponent(hyperFlushStateController);
@@ -118,10 +158,36 @@ public:
 
     addComponent(taskStateController);
     taskStateController.addObserver(status);
+    status.trackStates(taskStateController.stateTable(), taskStateController.numberOfStates());
+
+    // Machine 0 in the trace is the task state controller, 1 is HyperFlush
+    trace.track(taskStateController);
+    trace.track(hyperFlushStateController);
+    profiler.track(taskStateController);
     taskStateController.idle();
 
     addComponent(pressureSensor);
     pressureSensor.addObserver(status);
+    // After the sensor so each control tick sees the latest reading
+    addComponent(flowController);
+    addComponent(guard);
+    // The guard reads the sensor itself: put the reading that tripped in status so STOP
+    // logs it with the sample
+    guard.onTrip([this](float pressure) {
+        status.pressure    = pressure;
+        status.maxPressure = max(status.maxPressure, pressure);
+        pressureDidTrip();
+    });
+    pumps.onStart([this]() {
+        guard.arm();
+        status.taskDidSendFirstPumpCommand();
+    });
+
+    // After the last Wire.begin (pressure sensor), which resets the clock
+    {
+        I2CBus::Lock lock;
+        Wire.setClock(config.i2cClock);
+    }
 
     // RTC Interrupt callback
     power.onInterrupt([this]() {
@@ -153,21 +219,21 @@ public:
     }
 
     runForever(1000, "detailLog", [&]() { logDetail("detail.csv"); });
-    //5 minutes in millis
-    runForever(300000, "timeResync", [&](){
-        setTime(power.rtc.now().unixtime());
-    });
+    scheduleTimeResync(ClockSettings::MIN_RESYNC);
 
   }
 
       void logAfterSample() {
-        if(currentTaskId)
+        if(!currentTaskId)
           return;
         SD.begin(HardwarePins::SD_CARD);
         File log    = SD.open(config.logFile, FILE_WRITE);
         
         Task & task = tm.tasks.at(currentTaskId);
 
+        char valves[ProgramSettings::MAX_VALVES * 3 + 1];
+        status.currentValvesToString(valves, sizeof(valves));
+
         char formattedTime[64];
         auto utc = now();
         sprintf(
@@ -181,7 +247,7 @@ public:
             ",",
             task.name,
             ",",
-            status.currentValve,
+            valves,
             ",",
             status.currentStateName,
             ",",
@@ -193,8 +259,47 @@ public:
         log.println(data);
         log.flush();
         log.close();
+
+        trace.writeUnsaved(TraceSettings::FILE);
+        profiler.writeUnsaved(ProfileSettings::FILE);
+        actuator.writeUnsaved(ActuatorSettings::SKEW_LOG);
+        saveClockDrift();
       }
 
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Resync the Time library from the RTC after the given delay, then again
+   *  after the interval allowed by the drift model
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void scheduleTimeResync(unsigned long interval) {
+    TimedAction timeResync;
+    timeResync.name     = "timeResync";
+    timeResync.interval = interval;
+    timeResync.callback = [this]() { scheduleTimeResync(power.resync()); };
+    run(timeResync);
+  }
+
+  void saveClockDrift() {
+    JsonFileLoader loader;
+    loader.save(ClockSettings::FILE, power.drift);
+  }
+
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Record how far from its schedule the current task started
+   *
+   *  @param schedule Epoch the task was scheduled at
+   *  @param jitter Milliseconds late (negative: early)
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void logStartJitter(time_t schedule, long jitter) {
+    status.startJitter    = jitter;
+    status.maxStartJitter = max(status.maxStartJitter, labs(jitter));
+    println("Task started ", jitter, " ms from its schedule");
+
+    File log = SD.open(SchedulerSettings::START_LOG, FILE_WRITE);
+    KPStringBuilder<64> row{currentTaskId, ",", schedule, ",", jitter};
+    log.println(row);
+    log.close();
+  }
+
   void logDetail(const char * filename) {
     if(!currentTaskId)
       return;
@@ -207,6 +312,10 @@ public:
         formattedTime, "%u/%u/%u %02u:%02u:%02u GMT+0", year(utc), month(utc), day(utc),
         hour(utc), minute(utc), second(utc));
     Task & task = tm.tasks.at(currentTaskId);
+
+    char valves[ProgramSettings::MAX_VALVES * 3 + 1];
+    status.currentValvesToString(valves, sizeof(valves));
+
     KPStringBuilder<544> data{
         utc,
         ",",
@@ -214,7 +323,7 @@ public:
         ",",
         task.name,
         ",",
-        status.currentValve,
+        valves,
         ",",
         status.currentStateName,
         ",",
@@ -237,6 +346,15 @@ public:
      *  ──────────────────────────────────────────────────────────────────────────── */
     ScheduleReturnCode scheduleNextActiveTask(bool shouldStopCurrentTask = false) {
         status.preventShutdown = false;
+
+        // The running task keeps the pump train until it stops, even if the scheduling
+        // policy would now rank another due task ahead of it
+        if (currentTaskId && !shouldStopCurrentTask && tm.findTask(currentTaskId)
+            && tm.tasks[currentTaskId].status == TaskStatus::active) {
+            status.preventShutdown = true;
+            return ScheduleReturnCode::operating;
+        }
+
         for (auto id : tm.getActiveSortedTaskIds()) {
             Task & task     = tm.tasks[id];
             time_t time_now = now();
@@ -244,7 +362,7 @@ public:
             if (currentTaskId == id) {
                 // NOTE: Check logic here. Maybe not be correct yet
                 if (shouldStopCurrentTask) {
-                    cancel("delayTaskExecution");
+                    cancelPendingStart();
                     // if (status.currentStateName != HyperFlush::STOP) {
                     // 	newStateController.stop();
                     // }
@@ -256,47 +374,165 @@ public:
                 }
             }
 
-            if (time_now >= task.schedule) {
-                // Missed schedule
+            if (tm.isMissed(task, time_now)) {
+                // Missed schedule, beyond the lateness tolerance. A recurring task only
+                // loses this occurrence; its next one may now be the earliest schedule.
+                if (tm.skipMissedOccurrence(id, time_now)) {
+                    println(RED("Missed occurrence of "), task.name, ", next at ", task.schedule);
+                    tm.writeToDirectory();
+                    return scheduleNextActiveTask(shouldStopCurrentTask);
+                }
+
                 println(RED("Missed schedule"));
                 invalidateTaskAndFreeUpValves(task);
                 continue;
             }
 
-            if (time_now >= task.schedule - 10) {                
-                // Wake up between 10 secs of the actual schedule time
-                // Prepare an action to execute at exact time
-                taskToRun = false;
-                const auto timeUntil = task.schedule - time_now;
+            if (time_now >= task.schedule - wakeLead() - 2) {
+                // Wake up within the wake window of the actual schedule time
+                // Prepare an action to execute at exact time. A late task starts right away.
+                // Last stage of the alarm cascade: millis-precise from the RTC sync point
+                power.alarmAt        = 0;
+                const auto timeUntil = std::max<time_t>(task.schedule - time_now, 0);
+                const long untilStart = std::max(power.millisUntil(task.schedule), 0L);
                 TimedAction delayTaskExecution;
                 delayTaskExecution.name     = "delayTaskExecution";
-                delayTaskExecution.interval = secsToMillis(timeUntil);
-                delayTaskExecution.callback = [this]() { taskStateController.begin(); };
+                delayTaskExecution.interval = untilStart;
+                delayTaskExecution.callback = [this, schedule = task.schedule]() {
+                    const unsigned long dueAt = millis();
+                    const long jitter         = -power.millisUntil(schedule);
+                    taskStateController.begin();
+                    status.taskDidStartOnSchedule(dueAt);
+                    logStartJitter(schedule, jitter);
+                };
                 run(delayTaskExecution);  // async, will be execute later
 
                 taskStateController.configure(task);
 
                 currentTaskId          = id;
                 status.preventShutdown = true;
-                vm.setValveStatus(task.valves[task.valveOffsetStart], ValveStatus::operating);
+                status.flowStartedAt   = 0;
+                setNextValvesOperating(task);
+
+                // Bring the pumps up to full flow so sampling starts right at the schedule.
+                // Only when the task samples first: other phases drive the pumps otherwise.
+                if (config.primeTime > 0 && timeUntil > 0
+                    && task.getPhases().front().type == Phase::sample) {
+                    TimedAction primeTaskExecution;
+                    primeTaskExecution.name     = "primeTaskExecution";
+                    primeTaskExecution.interval = std::max(untilStart - long(secsToMillis(config.primeTime)), 0L);
+                    primeTaskExecution.callback = [this]() { primeCurrentValves(); };
+                    run(primeTaskExecution);
+                }
 
                 println("\033[32;1mExecuting task in ", timeUntil, " seconds\033[0m");
                 return ScheduleReturnCode::operating;
             } else {
                 // Wake up before not due to alarm, reschedule anyway
-                power.scheduleNextAlarm(task.schedule - 8);  // 3 < x < 10
-                workaroundTaskSchedule = task.schedule;
-                taskToRun = true;
+                power.scheduleNextAlarm(task.schedule - wakeLead());
                 println("SCHEDULED TASK FOR EXECUTION!");
                 return ScheduleReturnCode::scheduled;
             }
         }
 
         currentTaskId = 0;
-        taskToRun = false;
+        power.alarmAt = 0;
         return ScheduleReturnCode::unavailable;
   }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Seconds before a schedule the unit wakes up, leaving room for priming
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long wakeLead() const {
+        using namespace SchedulerSettings;
+        return std::max<long>(WAKE_LEAD, config.primeTime + PRIME_MARGIN);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start the pumps of the armed task ahead of its schedule. Sample then
+     *  begins at full flow and its sample time still counts from the schedule.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void primeCurrentValves() {
+        println(GREEN("Priming "), status.currentValves.size(), " valve(s)");
+        flowController.holdBaseline();
+        pumps.writeAll(currentValvePins(), PumpStatus::forwards);
+        status.flowDidStart();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief The overpressure guard cut the pumps: leave the running phase through
+     *  its -1 exit code, which leads to STOP
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void pressureDidTrip() {
+        if (taskStateController.currentPhase()) {
+            taskStateController.next(-1);
+        } else if (hyperFlushStateController.isInState(HyperFlush::OFFSHOOT_PRELOAD)) {
+            hyperFlushStateController.next(-1);
+        } else {
+            // Only the preservation pipeline was pumping
+            pipeline.stop();
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Drop the armed start of the current task, turning off primed pumps
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void cancelPendingStart() {
+        cancel("delayTaskExecution");
+        cancel("primeTaskExecution");
+        if (status.flowStartedAt) {
+            flowController.stop();
+            pumps.stopAll();
+            status.flowStartedAt = 0;
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Predict the execution timeline of every active task
+     *
+     *  @return TaskPlanner::Plan Per-valve start/end times, pump-on time and idle windows
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    TaskPlanner::Plan planActiveTasks() {
+        auto makeInput = [this](const Task & task) {
+            TaskPlanner::TaskInput input;
+            input.id               = task.id;
+            input.key              = tm.schedulingKey(task);
+            input.timeBetween      = task.timeBetween;
+            input.sampleTime       = task.sampleTime;
+            input.cycleTime        = task.getCycleTime();
+            input.recurrence       = task.recurrence;
+            input.valves           = task.valves.data();
+            input.numberOfValves   = task.getNumberOfValves();
+            input.valveOffsetStart = task.getValveOffsetStart();
+            input.successor        = task.successor;
+            input.concurrency      = std::min(std::max(task.concurrency, 1), config.maxConcurrentPumps);
+            input.pipelined        = task.pipelined;
+            return input;
+        };
+
+        std::vector<TaskPlanner::TaskInput> inputs;
+        for (auto id : tm.getActiveSortedTaskIds()) {
+            inputs.push_back(makeInput(tm.tasks[id]));
+            inputs.back().running = currentTaskId == id;
+        }
+
+        // Successors that are not active yet only run when their predecessor completes
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const int id      = inputs[i].successor;
+            const bool listed = std::any_of(inputs.begin(), inputs.end(),
+                [id](const TaskPlanner::TaskInput & input) { return input.id == id; });
+            if (!id || listed || !tm.findTask(id)) {
+                continue;
+            }
+
+            inputs.push_back(makeInput(tm.tasks[id]));
+            inputs.back().valveOffsetStart = 0;  // startTaskNow restarts from the first valve
+            inputs.back().waiting          = true;
+        }
+
+        return TaskPlanner::plan(inputs, now(), tm.schedulingPolicy());
+    }
+
       void validateTaskForSaving(const Task & task, JsonDocument & response) {
         if (task.status == 1) {
             response["error"] = "Task is current active";
@@ -309,7 +545,7 @@ public:
         }
     }
 
-        void validateTaskForScheduling(int id, JsonDocument & response) {
+        void validateTaskForScheduling(int id, JsonDocument & response, bool checkSchedule = true) {
         if (!tm.findTask(id)) {
             response["error"] = "Task not found";
             return;
@@ -321,7 +557,12 @@ public:
             return;
         }
 
-        if (task.schedule <= now() + 3) {
+        if (const char * error = task.validatePhases()) {
+            response["error"] = error;
+            return;
+        }
+
+        if (checkSchedule && task.schedule <= now() + 3) {
             response["error"] = "Must be in the future";
             return;
         }
@@ -347,31 +588,225 @@ public:
         }
     }
 
+    void validateTaskForStarting(int id, JsonDocument & response) {
+        if (currentTaskId) {
+            response["error"] = "Another task is being executed";
+            return;
+        }
+
+        if (!taskStateController.isInState(Main::IDLE)) {
+            response["error"] = "Task state machine is not idle";
+            return;
+        }
+
+        if (!hyperFlushStateController.isIdle()) {
+            response["error"] = "Preloading water is in operation";
+            return;
+        }
+
+        validateTaskForScheduling(id, response, false);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start a task right away without going through the RTC alarm and
+     *  delayTaskExecution. The task must have been validated with
+     *  validateTaskForStarting.
+     *
+     *  @param id Id of the task to start
+     *  @param requestedAt millis() when the start was requested, used to measure the
+     *  latency until the first pump command
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void startTaskNow(int id, unsigned long requestedAt) {
+        cancelPendingStart();
+        power.alarmAt = 0;
+
+        Task & task           = tm.tasks[id];
+        task.schedule         = now();
+        task.valveOffsetStart = 0;
+        tm.setTaskStatus(id, TaskStatus::active);
+        taskStateController.configure(task);
+
+        currentTaskId               = id;
+        status.preventShutdown      = true;
+        status.taskStartRequestedAt = requestedAt;
+        status.taskStartLatency     = -1;
+        setNextValvesOperating(task);
+        taskStateController.begin();
+
+        // Persist once the pump is running so SD access doesn't add to the start latency
+        tm.writeToDirectory();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start the successor of the task that just completed, if any. Called
+     *  from Idle once the pumps are off, before any other task is considered.
+     *
+     *  @return true if the successor was started
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool startPendingSuccessor() {
+        const int id       = pendingSuccessorId;
+        pendingSuccessorId = 0;
+        if (!id || currentTaskId) {
+            return false;
+        }
+
+        StaticJsonDocument<100> response;
+        validateTaskForScheduling(id, response, false);
+        if (response.containsKey("error")) {
+            println(RED("Successor not started: "), response["error"].as<const char *>());
+            return false;
+        }
+
+        println(GREEN("Starting successor task "), id);
+        startTaskNow(id, millis());
+        return true;
+    }
+
     void beginHyperFlush() {
         println("setting hf controller to begin");
         hyperFlushStateController.begin();
     }
 
-  int currentValveIdToPin() {
-        return status.currentValve;
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Mark the valves of the task's next cycle as operating. Up to the task's
+   *  concurrency, bounded by config.maxConcurrentPumps and by what the pump current
+   *  budget has left, run at the same time. At least one valve is always selected;
+   *  its pump waits in the arbiter queue if the budget is exhausted.
+   *
+   *  @param task Task about to run
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void setNextValvesOperating(const Task & task) {
+        const int pumpLimit = pumps.capacityFor(PumpSettings::FORWARDS, config.maxConcurrentPumps);
+        const int count     = task.getNextBatchSize(std::max(pumpLimit, 1));
+        for (int i = 0; i < count; i++) {
+            vm.setValveStatus(task.valves[task.valveOffsetStart + i], ValveStatus::operating);
+        }
+  }
+
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Check if the running task is pipelined and has valves left after the
+   *  ones that just finished sampling
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  bool shouldPipelineNextValves() {
+        if (!currentTaskId || !tm.findTask(currentTaskId)) {
+            return false;
+        }
+
+        const Task & task = tm.tasks[currentTaskId];
+        const int sampled = task.getValveOffsetStart() + status.currentValves.size();
+        return task.pipelined && sampled < task.getNumberOfValves();
+  }
+
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Move the valves that just finished sampling to the preservation pipeline
+   *  and make the next ones current. Only the offset moves: a pipelined task does
+   *  not wait timeBetween between valves.
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void handOffCurrentValves() {
+        Task & task = tm.tasks[currentTaskId];
+
+        // Copy: marking a valve as sampled removes it from the current valves
+        const std::vector<int> valves = status.currentValves;
+        for (auto v : valves) {
+            pipeline.preserve(v, task.preserveDrawTime, task.preserveTime);
+            vm.setValveStatus(v, ValveStatus::sampled);
+        }
+
+        task.valveOffsetStart += valves.size();
+        setNextValvesOperating(task);
+        println(GREEN("Pipelined "), valves.size(), " valve(s) into preservation");
+
+        vm.writeToDirectory();
+        tm.writeToDirectory();
+  }
+
+  const std::vector<int> & currentValvePins() const {
+        return status.currentValves;
   }
 
   void invalidateTaskAndFreeUpValves(Task & task) {
+        // An armed task that has not started yet releases the task state machine
+        if (task.id == currentTaskId
+            && taskStateController.isInState(Main::IDLE)) {
+            cancelPendingStart();
+            currentTaskId = 0;
+        }
+
         for (auto i = task.getValveOffsetStart(); i < task.getNumberOfValves(); i++) {
             vm.setValveFreeIfNotYetSampled(task.valves[i]);
         }
 
         task.valves.clear();
         tm.markTaskAsCompleted(task.id);
+        pendingSuccessorId = 0;
     }
 
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Park the peripherals, sleep until the RTC alarm, then restore them in a
+   *  fixed order: PWM drivers, pressure sensor, web server
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void standby() {
+    // standbyIfIdle waits for every pump to be back at neutral
+    pwm.sleep();
+    pressureSensor.park();
+    WiFi.end();
+    server.isRunning = false;
+
+    // Intermediate stages of the alarm cascade go straight back to sleep
+    do {
+        power.sleepForever();
+    } while (!power.advanceAlarm());
+    const unsigned long wokeAt = millis();
+
+    pwm.wakeup();
+    pressureSensor.restore();
+    server.setup();
+    server.begin();
+
+    status.wakeToReady = millis() - wokeAt;
+    println(GREEN("Ready "), status.wakeToReady, " ms after wake up");
+    idleSince = millis();
+  }
+
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Go to standby once the unit has been idle for config.standbyAfter seconds
+   *  with a task scheduled far enough ahead. Without a scheduled task nothing would
+   *  wake the unit up, so it stays awake.
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void standbyIfIdle() {
+    const bool idle = config.standbyAfter > 0 && power.alarmAt && !currentTaskId
+                      && taskStateController.isIdle() && hyperFlushStateController.isIdle()
+                      && !pipeline.isBusy() && !pumps.isPumping();
+    if (!idle) {
+      idleSince = millis();
+      return;
+    }
+
+    const long untilAlarm = long(power.alarmAt - now());
+    if (millis() - idleSince < secsToMillis(config.standbyAfter)
+        || untilAlarm < SchedulerSettings::MIN_STANDBY) {
+      return;
+    }
+
+    standby();
+  }
+
+  /** ────────────────────────────────────────────────────────────────────────────
+   *  @brief Schedule a timed action and wake the main loop when it is due
+   *  ──────────────────────────────────────────────────────────────────────────── */
+  void run(TimedAction action) {
+    DeadlineScheduler::sharedInstance().wakeIn(action.interval);
+    KPController::run(std::move(action));
+  }
+
   void update() override {
     KPController::update();
-    if(taskToRun){
-        if(workaroundTaskSchedule - 8 < now()){
-            scheduleNextActiveTask();
-        }
-    }
+
+    standbyIfIdle();
+
+    // Nothing to do until the next deadline; the web server still needs polling
+    DeadlineScheduler::sharedInstance().sleep(
+        server.isRunning ? DeadlineSettings::SERVER_POLL : DeadlineSettings::MAX_SLEEP);
 
     //If switch is up and wifi is running
     /*
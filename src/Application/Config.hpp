@@ -3,6 +3,8 @@
 #include <KPFoundation.hpp>
 
 #include <Application/Constants.hpp>
+#include <Components/RampProfile.hpp>
+#include <Components/ControlMode.hpp>
 #include <Utilities/JsonFileLoader.hpp>
 
 class Config : public JsonDecodable, public JsonEncodable, public Printable {
@@ -10,8 +12,43 @@ public:
     const char * configFilepath = nullptr;
     signed char valveUpperBound = 23;
     signed char numberOfValves  = 0;
-    signed char maxPressure = 0;
-    signed char cutoffPressure = 0;
+    // Pressure (sensor unit, mbar) that cuts the pumps; maxPressure applies when no
+    // cutoffPressure is set, 0 for neither
+    float maxPressure = 0;
+    float cutoffPressure = 0;
+    // PCF8523 offset register until drift.js holds a measured one
+    signed char rtcOffset = 0;
+    long latenessTolerance = SchedulerSettings::DEFAULT_LATENESS_TOLERANCE;
+    int maxConcurrentPumps = 1;
+    // Pump current limit in mA, 0 for no limit
+    long pumpCurrentBudget = 0;
+    long pumpFullThrottleCurrent = PumpSettings::FULL_THROTTLE_CURRENT;
+    // Valves of the same group preloaded at once by HyperFlush, 0 for the whole group
+    int preloadParallelism = 1;
+    // Seconds the pumps of the upcoming valves run before the schedule, 0 to disable
+    int primeTime = 0;
+    // Seconds the unit idles with a task scheduled before going to standby, 0 (default) to
+    // stay awake. In standby the unit sleeps until the RTC alarm, WAKE_LEAD seconds (or
+    // primeTime + PRIME_MARGIN) ahead of the next schedule, and the web UI is unreachable.
+    int standbyAfter = SchedulerSettings::DEFAULT_STANDBY_AFTER;
+    // I2C bus clock (Hz) shared by the PWM drivers, the RTC and the pressure sensor
+    unsigned long i2cClock = I2CSettings::DEFAULT_CLOCK;
+    // Soft start/stop of the pumps: ramp time (ms) of each channel, 0 (default) to jump.
+    // Channels missing from rampTimes use rampTime.
+    int rampTime = RampSettings::DEFAULT_TIME;
+    unsigned short rampTimes[PumpSettings::CHANNELS] = {0};
+    RampShape rampShape = RampShape::scurve;
+    // Closed-loop control of the sampling pumps ("off", "pressure" or "flow"): target in
+    // mbar above the pressure before pumping or in mL/s per pump, PID gains in µs per
+    // unit of error, pulse width limits (µs) and period (ms)
+    ControlMode controlMode = ControlMode::off;
+    float controlTarget = 0;
+    float controlKp     = 0;
+    float controlKi     = 0;
+    float controlKd     = 0;
+    int controlMinPulse = PumpSettings::OFF;
+    int controlMaxPulse = PumpSettings::OFF + PumpSettings::FULL_THROTTLE;
+    unsigned long controlPeriod = ControlSettings::DEFAULT_PERIOD;
 
 
     signed char valves[ProgramSettings::MAX_VALVES]        = {0};
@@ -31,8 +68,22 @@ public:
         return "Config";
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Size of a config.js with every key, all the valves free and a ramp time
+     *  for every channel. Strings are copied: the keys, the four file names and the
+     *  longest rampShape ("scurve") and controlMode ("pressure") values.
+     *  ──────────────────────────────────────────────────────────────────────────── */
     static constexpr size_t decodingSize() {
-        return ProgramSettings::CONFIG_JSON_BUFFER_SIZE;
+        using namespace ConfigKeys;
+        return jsonObjectSize(VALVES_FREE, VALVE_UPPER_BOUND, FILE_LOG, FILE_STATUS, FOLDER_TASK,
+                              FOLDER_VALVE, PRESSURE_CUTOFF, PRESSURE_MAX, RTC_OFFSET, PWM_1_OSC_FREQ,
+                              PWM_2_OSC_FREQ, LATENESS_TOLERANCE, MAX_CONCURRENT_PUMPS,
+                              PUMP_CURRENT_BUDGET, PUMP_FULL_THROTTLE_CURRENT, PRELOAD_PARALLELISM,
+                              STANDBY_AFTER, I2C_CLOCK, RAMP_TIME, RAMP_TIMES, RAMP_SHAPE,
+                              CONTROL_MODE, CONTROL_TARGET, CONTROL_KP, CONTROL_KI, CONTROL_KD,
+                              CONTROL_MIN_PULSE, CONTROL_MAX_PULSE, CONTROL_PERIOD, PRIME_TIME)
+             + JSON_ARRAY_SIZE(ProgramSettings::MAX_VALVES) + JSON_ARRAY_SIZE(PumpSettings::CHANNELS)
+             + 4 * ProgramSettings::SD_FILE_NAME_LENGTH + jsonStringSize("scurve", "pressure");
     }
 
     void decodeJSON(const JsonVariant & source) override {
@@ -40,9 +91,36 @@ public:
         using namespace ConfigKeys;
 
         valveUpperBound = source[VALVE_UPPER_BOUND];
-        maxPressure = source[PRESSURE_MAX];
-        cutoffPressure = source[PRESSURE_CUTOFF];
+        maxPressure = source[PRESSURE_MAX] | 0.0f;
+        cutoffPressure = source[PRESSURE_CUTOFF] | 0.0f;
+        rtcOffset = constrain(source[RTC_OFFSET] | 0, -64, 63);
         numberOfValves  = valveUpperBound + 1;
+        latenessTolerance = source[LATENESS_TOLERANCE] | SchedulerSettings::DEFAULT_LATENESS_TOLERANCE;
+        maxConcurrentPumps = max(source[MAX_CONCURRENT_PUMPS] | 1, 1);
+        pumpCurrentBudget = max(source[PUMP_CURRENT_BUDGET] | 0L, 0L);
+        pumpFullThrottleCurrent = source[PUMP_FULL_THROTTLE_CURRENT] | PumpSettings::FULL_THROTTLE_CURRENT;
+        preloadParallelism = max(source[PRELOAD_PARALLELISM] | 1, 0);
+        primeTime = max(source[PRIME_TIME] | 0, 0);
+        standbyAfter = max(source[STANDBY_AFTER] | SchedulerSettings::DEFAULT_STANDBY_AFTER, 0);
+        i2cClock = source[I2C_CLOCK] | I2CSettings::DEFAULT_CLOCK;
+        rampTime = constrain(source[RAMP_TIME] | RampSettings::DEFAULT_TIME, 0, 0xFFFF);
+        rampShape = strcmp(source[RAMP_SHAPE] | "scurve", "linear") == 0 ? RampShape::linear
+                                                                         : RampShape::scurve;
+        std::fill_n(rampTimes, PumpSettings::CHANNELS, rampTime);
+        controlMode = parseControlMode(source[CONTROL_MODE] | "off");
+        controlTarget = source[CONTROL_TARGET] | 0.0f;
+        controlKp = source[CONTROL_KP] | 0.0f;
+        controlKi = source[CONTROL_KI] | 0.0f;
+        controlKd = source[CONTROL_KD] | 0.0f;
+        controlMinPulse = constrain(source[CONTROL_MIN_PULSE] | PumpSettings::OFF, PumpSettings::MIN_PULSE,
+                                    PumpSettings::MAX_PULSE);
+        controlMaxPulse = constrain(source[CONTROL_MAX_PULSE] | PumpSettings::OFF + PumpSettings::FULL_THROTTLE,
+                                    controlMinPulse, PumpSettings::MAX_PULSE);
+        controlPeriod = max(source[CONTROL_PERIOD] | ControlSettings::DEFAULT_PERIOD, ControlSettings::MIN_PERIOD);
+        JsonArrayConst config_ramp_times = source[RAMP_TIMES].as<JsonArrayConst>();
+        for (size_t i = 0; i < config_ramp_times.size() && i < PumpSettings::CHANNELS; i++) {
+            rampTimes[i] = constrain(config_ramp_times[i] | rampTime, 0, 0xFFFF);
+        }
 
         std::fill_n(valves, ProgramSettings::MAX_VALVES, -1);
 
@@ -73,7 +151,7 @@ public:
     }
 
     static constexpr size_t encodingSize() {
-        return ProgramSettings::CONFIG_JSON_BUFFER_SIZE;
+        return decodingSize();
     }
 
     bool encodeJSON(const JsonVariant & dest) const override {
@@ -81,11 +159,32 @@ public:
 
         JsonArray array_array = dest.createNestedArray(VALVES_FREE);
         copyArray(valves, array_array);
+        JsonArray ramp_times = dest.createNestedArray(RAMP_TIMES);
+        copyArray(rampTimes, ramp_times);
 
         return dest[VALVE_UPPER_BOUND].set(valveUpperBound) && dest[FILE_LOG].set(logFile)
                && dest[FILE_STATUS].set(statusFile) && dest[FOLDER_TASK].set(taskFolder)
                && dest[FOLDER_VALVE].set(valveFolder) && dest[PRESSURE_MAX].set(maxPressure)
-               && dest[PRESSURE_CUTOFF].set(cutoffPressure);
+               && dest[PRESSURE_CUTOFF].set(cutoffPressure)
+               && dest[RTC_OFFSET].set(rtcOffset)
+               && dest[LATENESS_TOLERANCE].set(latenessTolerance)
+               && dest[MAX_CONCURRENT_PUMPS].set(maxConcurrentPumps)
+               && dest[PUMP_CURRENT_BUDGET].set(pumpCurrentBudget)
+               && dest[PUMP_FULL_THROTTLE_CURRENT].set(pumpFullThrottleCurrent)
+               && dest[PRELOAD_PARALLELISM].set(preloadParallelism)
+               && dest[PRIME_TIME].set(primeTime)
+               && dest[STANDBY_AFTER].set(standbyAfter)
+               && dest[I2C_CLOCK].set(i2cClock)
+               && dest[RAMP_TIME].set(rampTime)
+               && dest[RAMP_SHAPE].set(rampShape == RampShape::linear ? "linear" : "scurve")
+               && dest[CONTROL_MODE].set(controlModeName(controlMode))
+               && dest[CONTROL_TARGET].set(controlTarget)
+               && dest[CONTROL_KP].set(controlKp)
+               && dest[CONTROL_KI].set(controlKi)
+               && dest[CONTROL_KD].set(controlKd)
+               && dest[CONTROL_MIN_PULSE].set(controlMinPulse)
+               && dest[CONTROL_MAX_PULSE].set(controlMaxPulse)
+               && dest[CONTROL_PERIOD].set(controlPeriod);
     }
 #pragma endregion
 #pragma region PRINTABLE
@@ -42,20 +42,157 @@ namespace HardwarePins {
 namespace ProgramSettings {
     __k_auto CONFIG_FILE_PATH          = "config.js";
     __k_auto SD_FILE_NAME_LENGTH       = 13;
-    __k_auto CONFIG_JSON_BUFFER_SIZE   = 800;
-    __k_auto STATUS_JSON_BUFFER_SIZE   = 800;
-    __k_auto TASK_JSON_BUFFER_SIZE     = 1000;
+    __k_auto TASK_JSON_BUFFER_SIZE     = 1500;
     __k_auto TASKREF_JSON_BUFFER_SIZE  = 50;
     __k_auto MAX_VALVES                = 24;
     __k_auto VALVE_JSON_BUFFER_SIZE    = 500;
     __k_auto VALVEREF_JSON_BUFFER_SIZE = 50;
     __k_auto VALVE_GROUP_LENGTH        = 25;
+    __k_auto PLAN_JSON_BUFFER_SIZE     = 4000;
+    __k_auto TRACE_JSON_BUFFER_SIZE    = 4000;
+    __k_auto PROFILE_JSON_BUFFER_SIZE  = 4000;
+    __k_auto METRICS_JSON_BUFFER_SIZE  = 800;
 };  // namespace ProgramSettings
 
+namespace SchedulerSettings {
+    // Seconds a task may start late before it is dropped, unless the task overrides it
+    __k_auto DEFAULT_LATENESS_TOLERANCE = 900;
+
+    // Seconds before a schedule the RTC alarm wakes the unit (see App::wakeLead)
+    __k_auto WAKE_LEAD = 8;
+    // Extra seconds of wake lead kept ahead of priming
+    __k_auto PRIME_MARGIN = 2;
+    // Default seconds of idling before standby (off unless config.js sets standbyAfter),
+    // and shortest standby worth entering
+    __k_auto DEFAULT_STANDBY_AFTER = 0;
+    __k_auto MIN_STANDBY           = 30;
+    // Task id, schedule and start jitter (ms) of every scheduled start
+    __k_auto START_LOG = "starts.csv";
+};  // namespace SchedulerSettings
+
+namespace ClockSettings {
+    __k_auto FILE             = "drift.js";
+    __k_auto JSON_BUFFER_SIZE = 200;
+    // ppm corrected by one step of the PCF8523 offset register (two-hour mode)
+    __k_auto OFFSET_STEP = 4.34f;
+    // Shortest spans (s) measuring the RTC drift and the millis() drift
+    __k_auto MIN_CALIBRATION_PERIOD = 7 * 86400L;
+    __k_auto MIN_MILLIS_PERIOD      = 600L;
+    // Error (s) of the RTC drift measurement: whole seconds on both ends of the window
+    // plus the browser latency of /api/rtc/update
+    __k_auto SYNC_RESOLUTION = 2;
+    // Largest TimeLib error (ms) between resyncs, smallest drift (ppm) assumed for it,
+    // and bounds of the resync interval (ms)
+    __k_auto ERROR_BUDGET = 500;
+    __k_auto DRIFT_FLOOR  = 5.0f;
+    __k_auto MIN_RESYNC   = 300000ul;
+    __k_auto MAX_RESYNC   = 21600000ul;
+};  // namespace ClockSettings
+
+namespace I2CSettings {
+    __k_auto DEFAULT_CLOCK = 100000ul;
+    // Attempts after the first one for a transaction that is not acknowledged
+    __k_auto RETRIES = 2;
+};  // namespace I2CSettings
+
+namespace DeadlineSettings {
+    // Pending wake times of the main loop
+    __k_auto CAPACITY = 16;
+    // Longest sleep (ms) while the web server has to be polled, and otherwise
+    __k_auto SERVER_POLL = 20;
+    __k_auto MAX_SLEEP   = 1000;
+};  // namespace DeadlineSettings
+
+namespace PumpSettings {
+    // Pulse widths (µs) sent to the thruster ESCs
+    __k_auto OFF       = 1500;
+    __k_auto FORWARDS  = 1800;
+    __k_auto BACKWARDS = 1400;
+    __k_auto PRESERVE  = 1600;
+    // Range of pulse widths the ESCs accept
+    __k_auto MIN_PULSE = 1100;
+    __k_auto MAX_PULSE = 1900;
+
+    // ESC deadband around OFF and pulse width deviation at full throttle
+    __k_auto DEADBAND          = 25;
+    __k_auto FULL_THROTTLE     = 400;
+    // Estimated draw (mA) of one pump at full throttle
+    __k_auto FULL_THROTTLE_CURRENT = 17000;
+
+    // PWM channels wired to pumps
+    __k_auto CHANNELS = 16;
+};  // namespace PumpSettings
+
+namespace PressureSettings {
+    // Time (ms) between two readings of the pressure sensor when nothing asks for more
+    __k_auto INTERVAL = 1000ul;
+    // Keller LD I2C address and conversion request, and the conversion time (µs) the
+    // library waits before reading the result
+    __k_auto ADDRESS         = 0x40;
+    __k_auto REQUEST         = 0xAC;
+    __k_auto CONVERSION_TIME = 9000ul;
+};  // namespace PressureSettings
+
+namespace GuardSettings {
+    // Time (ms) between two conversions of the guard's own readings while any pump runs
+    __k_auto INTERVAL = 50ul;
+    __k_auto FILE     = "overpressure.csv";
+};  // namespace GuardSettings
+
+namespace ControlSettings {
+    // Default period (ms) of the flow control loop
+    __k_auto DEFAULT_PERIOD = 100ul;
+    __k_auto MIN_PERIOD     = 20ul;
+};  // namespace ControlSettings
+
+namespace FlowSettings {
+    __k_auto FILE = "calib.js";
+    // Largest calib.js document (bytes) allowed on the stack while loading
+    __k_auto MAX_JSON_BUFFER_SIZE = 8192;
+    // Calibration points per pump channel
+    __k_auto MAX_POINTS = 6;
+    // Longest time (ms) between two integration steps of the sampled volume
+    __k_auto INTEGRATION_INTERVAL = 250ul;
+};  // namespace FlowSettings
+
+namespace RampSettings {
+    // Points of the ramp lookup tables, and the fixed point scale of their values
+    __k_auto STEPS = 32;
+    __k_auto SCALE = 1024u;
+    // Time (ms) between two writes of a ramp, and the default ramp time (ms)
+    __k_auto STEP_INTERVAL = 20;
+    __k_auto DEFAULT_TIME  = 0;
+};  // namespace RampSettings
+
+namespace ActuatorSettings {
+    // Pending timed pump commands, and sent ones kept for the skew log (16 bytes each)
+    __k_auto CAPACITY     = 8;
+    __k_auto LOG_CAPACITY = 32;
+    // TC3 interrupt rate (Hz) and NVIC priority (3: lowest, below SysTick and Wire)
+    __k_auto TICK_RATE    = 1000;
+    __k_auto IRQ_PRIORITY = 3;
+    __k_auto SKEW_LOG     = "skew.csv";
+};  // namespace ActuatorSettings
+
+namespace TraceSettings {
+    // Transition events kept in memory (8 bytes each)
+    __k_auto CAPACITY = 32;
+    __k_auto FILE     = "trace.csv";
+};  // namespace TraceSettings
+
+namespace ProfileSettings {
+    // Per-valve phase records kept in memory (12 bytes each), and the newest ones served
+    // by /api/profile
+    __k_auto CAPACITY = 48;
+    __k_auto SERVED   = 16;
+    __k_auto FILE     = "profile.csv";
+};  // namespace ProfileSettings
+
 namespace TaskSettings {
     __k_auto NAME_LENGTH  = 25;
     __k_auto GROUP_LENGTH = 25;
     __k_auto NOTES_LENGTH = 80;
+    __k_auto MAX_PHASES   = 8;
 };  // namespace TaskSettings
 
 //
@@ -77,6 +214,25 @@ namespace ConfigKeys {
     __k_auto RTC_OFFSET        = "RTCOffset";
     __k_auto PWM_1_OSC_FREQ    = "OscillatorFrequency1";
     __k_auto PWM_2_OSC_FREQ    = "OscillatorFrequency2";
+    __k_auto LATENESS_TOLERANCE = "latenessTolerance";
+    __k_auto MAX_CONCURRENT_PUMPS = "maxConcurrentPumps";
+    __k_auto PUMP_CURRENT_BUDGET  = "pumpCurrentBudget";
+    __k_auto PUMP_FULL_THROTTLE_CURRENT = "pumpFullThrottleCurrent";
+    __k_auto PRELOAD_PARALLELISM = "preloadParallelism";
+    __k_auto STANDBY_AFTER       = "standbyAfter";
+    __k_auto I2C_CLOCK           = "i2cClock";
+    __k_auto RAMP_TIME           = "rampTime";
+    __k_auto RAMP_TIMES          = "rampTimes";
+    __k_auto RAMP_SHAPE          = "rampShape";
+    __k_auto CONTROL_MODE        = "controlMode";
+    __k_auto CONTROL_TARGET      = "controlTarget";
+    __k_auto CONTROL_KP          = "controlKp";
+    __k_auto CONTROL_KI          = "controlKi";
+    __k_auto CONTROL_KD          = "controlKd";
+    __k_auto CONTROL_MIN_PULSE   = "controlMinPulse";
+    __k_auto CONTROL_MAX_PULSE   = "controlMaxPulse";
+    __k_auto CONTROL_PERIOD      = "controlPeriod";
+    __k_auto PRIME_TIME          = "primeTime";
 }  // namespace ConfigKeys
 
 namespace TaskKeys {
@@ -98,6 +254,18 @@ namespace TaskKeys {
     __k_auto PRESERVE_TIME   = "preserveTime";
     __k_auto PRESERVE_TIME_DRAW   = "preserveDrawTime";
     __k_auto CURR_VALVE   = "currentValve";
+    __k_auto PRIORITY        = "priority";
+    __k_auto LATENESS_TOLERANCE = "latenessTolerance";
+    __k_auto RECURRENCE_ORIGIN   = "recurrenceOrigin";
+    __k_auto RECURRENCE_INTERVAL = "recurrenceInterval";
+    __k_auto RECURRENCE_DAYS     = "recurrenceDays";
+    __k_auto RECURRENCE_HOURS    = "recurrenceHours";
+    __k_auto SUCCESSOR       = "successor";
+    __k_auto CONCURRENCY     = "concurrency";
+    __k_auto PIPELINED       = "pipelined";
+    __k_auto PHASES          = "phases";
+    __k_auto PHASE_TYPE      = "type";
+    __k_auto PHASE_TIME      = "time";
 }  // namespace TaskKeys
 
 namespace ValveKeys {
@@ -121,10 +289,78 @@ namespace StatusKeys {
     __k_auto SENSOR_FLOW     = "waterFlow";
     __k_auto SENSOR_DEPTH    = "waterDepth";
     __k_auto CURRENT_TASK    = "currentTask";
+    __k_auto START_FLOW_LATENCY = "startFlowLatency";
     __k_auto CURRENT_STATE   = "currentState";
+    __k_auto CURRENT_STATE_ID = "currentStateId";
     __k_auto LOW_BATTERY     = "lowBattery";
     __k_auto SAMPLE_VOLUME   = "sampleVolume";
     __k_auto PRESSURE_CUTOFF   = "cutoffPressure";
+    __k_auto TASK_START_LATENCY = "taskStartLatency";
+    __k_auto WAKE_TO_READY   = "wakeToReady";
+    __k_auto START_JITTER    = "startJitter";
+    __k_auto MAX_START_JITTER = "maxStartJitter";
 };  // namespace StatusKeys
 
+namespace PlanKeys {
+    __k_auto BEGIN     = "begin";
+    __k_auto END       = "end";
+    __k_auto VALVES    = "valves";
+    __k_auto IDLE      = "idle";
+    __k_auto MISSED    = "missed";
+    __k_auto PUMP_ON   = "pumpOnSeconds";
+};  // namespace PlanKeys
+
+namespace ClockKeys {
+    __k_auto RTC_OFFSET   = "rtcOffset";
+    __k_auto RTC_DRIFT    = "rtcDrift";
+    __k_auto REFERENCE    = "reference";
+    __k_auto CORRECTION   = "correction";
+    __k_auto MILLIS_DRIFT = "millisDrift";
+};  // namespace ClockKeys
+
+namespace FlowKeys {
+    __k_auto PRESSURE_COEFFICIENT = "pressureCoefficient";
+    __k_auto CHANNELS             = "channels";
+    __k_auto PRESSURE             = "pressure";
+    __k_auto POINTS               = "points";
+};  // namespace FlowKeys
+
+namespace MetricsKeys {
+    __k_auto I2C_CLOCK         = "i2cClock";
+    __k_auto TRANSACTIONS      = "transactions";
+    __k_auto RETRIES           = "retries";
+    __k_auto NACKS             = "nacks";
+    __k_auto TIMEOUTS          = "timeouts";
+    __k_auto FAILURES          = "failures";
+    __k_auto SKIPPED           = "skipped";
+    __k_auto LATENCY_EDGES     = "latencyEdges";
+    __k_auto LATENCY_HISTOGRAM = "latencyHistogram";
+    __k_auto SHUTDOWN_LATENCY  = "shutdownLatency";
+    __k_auto MAX_SHUTDOWN_LATENCY = "maxShutdownLatency";
+    __k_auto ACTUATION_SKEW       = "actuationSkew";
+    __k_auto MAX_ACTUATION_SKEW   = "maxActuationSkew";
+    __k_auto PENDING_ACTUATIONS   = "pendingActuations";
+    __k_auto CONTROL_OUTPUT       = "controlOutput";
+    __k_auto CONTROL_TICKS        = "controlTicks";
+    __k_auto CONTROL_JITTER       = "controlJitter";
+    __k_auto MAX_CONTROL_JITTER   = "maxControlJitter";
+    __k_auto MISSED_CONTROL_TICKS = "missedControlTicks";
+    __k_auto CUTOFF_PRESSURE      = "cutoffPressure";
+    __k_auto CUTOFF_EVENTS        = "cutoffEvents";
+    __k_auto CUTOFF_LATENCY       = "cutoffLatency";
+    __k_auto MAX_CUTOFF_LATENCY   = "maxCutoffLatency";
+    __k_auto MAX_CUTOFF_BLIND     = "maxCutoffBlindTime";
+};  // namespace MetricsKeys
+
+namespace TraceKeys {
+    __k_auto EVENTS  = "events";
+    __k_auto DROPPED = "dropped";
+};  // namespace TraceKeys
+
+namespace ProfileKeys {
+    __k_auto PHASES  = "phases";
+    __k_auto RECENT  = "recent";
+    __k_auto DROPPED = "dropped";
+};  // namespace ProfileKeys
+
 #undef __k_auto
@@ -0,0 +1,182 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include <KPFoundation.hpp>
+#include <KPStateMachine.hpp>
+#include "SD.h"
+
+#include <Application/Constants.hpp>
+#include <StateControllers/TaskStateController.hpp>
+#include <Task/Phase.hpp>
+#include <Utilities/RingLog.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: P H A S E   P R O F I L E R : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────
+//
+// Planned-vs-actual timing of the phases run by the task state controller. A phase is
+// opened when its state begins and closed when the controller enters any other state;
+// each closed phase yields one record per valve it ran for. The states wait for
+// Phase::padding seconds on top of the configured time, so the overrun of a phase is
+// measured against the configured time and the padding shows up in it.
+//
+struct PhaseRecord {
+    uint32_t actual;      // Milliseconds from entering to leaving the phase
+    uint16_t configured;  // Configured time (seconds)
+    uint16_t latency;     // Milliseconds from the transition request to entering
+    int8_t valve;
+    uint8_t type;         // Phase::Type
+    int8_t code;          // Exit code (-1: panic)
+    uint8_t reserved;
+};
+
+static_assert(sizeof(PhaseRecord) == 12, "Phase records must stay 12 bytes");
+
+// Running totals of one phase type
+struct PhaseAggregate {
+    uint32_t count      = 0;
+    uint32_t panics     = 0;
+    uint32_t configured = 0;  // ms
+    uint32_t actual     = 0;  // ms
+    uint32_t latency    = 0;  // ms
+    int32_t maxOverrun  = 0;  // ms, valid once count > 0
+    uint32_t maxLatency = 0;  // ms
+
+    int32_t meanOverrun() const {
+        return count ? (int32_t(actual) - int32_t(configured)) / int32_t(count) : 0;
+    }
+
+    uint32_t meanLatency() const {
+        return count ? latency / count : 0;
+    }
+};
+
+class PhaseProfiler : public KPStateMachineObserver {
+private:
+    TaskStateController * sm = nullptr;
+    const std::vector<int> & currentValves;
+
+    // Phase currently open
+    Phase open;
+    unsigned long openedAt = 0;
+    uint16_t openLatency   = 0;
+    std::vector<int> openValves;
+
+    RingLog<PhaseRecord, ProfileSettings::CAPACITY> records;
+    std::array<PhaseAggregate, Phase::count> aggregates;
+
+    const char * KPStateMachineObserverName() const override {
+        return "PhaseProfiler-KPStateMachine Observer";
+    }
+
+    void stateDidBegin(const KPState * current) override {
+        if (sm->indexOf(current) < 0) {
+            return;
+        }
+
+        const unsigned long now = millis();
+        if (open.type != Phase::invalid) {
+            close(now, sm->lastExitCode());
+        }
+
+        const Phase * phase = sm->currentPhase();
+        if (phase) {
+            open        = *phase;
+            openedAt    = now;
+            openLatency = min(now - sm->lastTransitionRequestedAt(), 0xFFFFul);
+            openValves  = currentValves;
+        }
+    }
+
+    void close(unsigned long now, int code) {
+        PhaseRecord record;
+        record.actual     = now - openedAt;
+        record.configured = open.time;
+        record.latency    = openLatency;
+        record.type       = open.type;
+        record.code       = code;
+        record.reserved   = 0;
+
+        const int32_t configuredMs = open.time * 1000;
+        auto & aggregate           = aggregates[open.type];
+        for (auto v : openValves) {
+            record.valve = v;
+            records.push(record);
+
+            const int32_t overrun = int32_t(record.actual) - configuredMs;
+            aggregate.maxOverrun  = aggregate.count ? max(aggregate.maxOverrun, overrun) : overrun;
+            aggregate.maxLatency  = max(aggregate.maxLatency, uint32_t(record.latency));
+            aggregate.count++;
+            aggregate.panics += code == -1;
+            aggregate.configured += configuredMs;
+            aggregate.actual += record.actual;
+            aggregate.latency += record.latency;
+        }
+
+        open.type = Phase::invalid;
+    }
+
+public:
+    explicit PhaseProfiler(const std::vector<int> & currentValves)
+        : currentValves(currentValves) {
+        openValves.reserve(ProgramSettings::MAX_VALVES);
+    }
+
+    void track(TaskStateController & controller) {
+        sm = &controller;
+        sm->addObserver(this);
+    }
+
+    const PhaseAggregate & aggregate(Phase::Type type) const {
+        return aggregates[type];
+    }
+
+    // Unsaved records overwritten before they could be written to SD
+    uint32_t numberOfDroppedRecords() const {
+        return records.numberOfDropped();
+    }
+
+    // Clear the aggregates, e.g. before measuring the effect of a timing change
+    void reset() {
+        aggregates.fill(PhaseAggregate{});
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Visit the records from the oldest to the newest
+     *
+     *  @param last Only visit the newest `last` records
+     *  @param visit Called with each record
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename Visitor>
+    void forEach(size_t last, Visitor && visit) const {
+        records.forEach(last, std::forward<Visitor>(visit));
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor && visit) const {
+        records.forEach(std::forward<Visitor>(visit));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Append the records not saved yet to the profile file as CSV rows
+     *  (valve, phase, configured s, actual ms, latency ms, code)
+     *
+     *  @param filename Path of the profile file on the SD card
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writeUnsaved(const char * filename) {
+        if (!records.numberOfUnsaved()) {
+            return;
+        }
+
+        File file = SD.open(filename, FILE_WRITE);
+        records.forEachUnsaved([&file](const PhaseRecord & r) {
+            KPStringBuilder<80> row{int(r.valve), ",", Phase::name(Phase::Type(r.type)), ",",
+                                    r.configured, ",", r.actual, ",", r.latency, ",", int(r.code)};
+            file.println(row);
+        });
+
+        file.close();
+    }
+};
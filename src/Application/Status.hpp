@@ -19,7 +19,8 @@ class Status : public JsonDecodable,
                public PressureSensorObserver {
 public:
     std::vector<int> valves;
-    int currentValve   = -1;
+    // Valves of the running cycle, in the order they were started
+    std::vector<int> currentValves;
     float pressure     = 0;
     float temperature  = 0;
     float barometric   = 0;
@@ -32,7 +33,30 @@ public:
 
     bool preventShutdown = false;
 
+    // millis() when an immediate start was requested, 0 if none is pending
+    unsigned long taskStartRequestedAt = 0;
+    // Milliseconds from the last immediate start request to its first granted pump
+    // command, -1 until granted
+    long taskStartLatency = -1;
+
+    // millis() of the first forward pump command of the armed task, 0 if none yet
+    unsigned long flowStartedAt = 0;
+    // Milliseconds from the last scheduled start to its first forward pump command.
+    // Negative when the pumps were primed ahead of the schedule.
+    long startFlowLatency = 0;
+
+    // Milliseconds from waking up from standby until the peripherals were restored,
+    // -1 before the first standby
+    long wakeToReady = -1;
+
+    // Milliseconds the last scheduled task started after its schedule (negative: before),
+    // and the largest deviation since boot
+    long startJitter    = 0;
+    long maxStartJitter = 0;
+
     const char * currentStateName = nullptr;
+    // Index of the current state in the tracked state table, -1 if unknown
+    int currentStateId = -1;
     const char * currentTaskName  = nullptr;
 
     Status() = default;
@@ -70,19 +94,20 @@ private:
     }
 
     void valveDidUpdate(const Valve & valve) override {
-        if (valve.id == currentValve && valve.status == ValveStatus::sampled) {
-            currentValve = -1;
-        }
-
+        auto current = std::find(currentValves.begin(), currentValves.end(), valve.id);
         if (valve.status == ValveStatus::operating) {
-            currentValve = valve.id;
+            if (current == currentValves.end()) {
+                currentValves.push_back(valve.id);
+            }
+        } else if (current != currentValves.end()) {
+            currentValves.erase(current);
         }
 
         valves[valve.id] = valve.status;
     }
 
     void valveArrayDidUpdate(const std::vector<Valve> & valves) override {
-        currentValve = -1;
+        currentValves.clear();
         for (const Valve & v : valves) {
             valveDidUpdate(v);
         }
@@ -90,6 +115,55 @@ private:
 
     void stateDidBegin(const KPState * current) override {
         currentStateName = current->getName();
+        currentStateId   = -1;
+        for (size_t i = 0; i < numberOfStates; i++) {
+            if (states[i] == current) {
+                currentStateId = i;
+                break;
+            }
+        }
+    }
+
+    const KPState * const * states = nullptr;
+    size_t numberOfStates          = 0;
+
+public:
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Report state ids from the given table (see IndexedStateController)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void trackStates(const KPState * const * table, size_t count) {
+        states         = table;
+        numberOfStates = count;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Called when the pump arbiter grants the first pump command of a task,
+     *  whichever phase sends it. Completes the latency measurement of a pending
+     *  immediate start; a queued command does not count until it is granted.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void taskDidSendFirstPumpCommand() {
+        if (taskStartRequestedAt) {
+            taskStartLatency     = millis() - taskStartRequestedAt;
+            taskStartRequestedAt = 0;
+        }
+    }
+
+    void flowDidStart() {
+        if (!flowStartedAt) {
+            flowStartedAt = millis();
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Called once a scheduled task has been started
+     *
+     *  @param dueAt millis() at which the task was due
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void taskDidStartOnSchedule(unsigned long dueAt) {
+        if (flowStartedAt) {
+            startFlowLatency = long(flowStartedAt - dueAt);
+            flowStartedAt    = 0;
+        }
     }
 
 public:
@@ -106,6 +180,28 @@ public:
         return true;
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Write the current valves separated by spaces, or -1 if there is none
+     *
+     *  @param dst Destination buffer
+     *  @param size Size of the destination buffer
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void currentValvesToString(char * dst, size_t size) const {
+        if (currentValves.empty()) {
+            snprintf(dst, size, "-1");
+            return;
+        }
+
+        size_t length = 0;
+        for (auto v : currentValves) {
+            if (length >= size) {
+                break;
+            }
+
+            length += snprintf(dst + length, size - length, length ? " %d" : "%d", v);
+        }
+    }
+
     float isBatteryLow() const {
         return analogRead(HardwarePins::BATTERY_VOLTAGE) * (16.8 / 1023.0);
     }
@@ -116,7 +212,7 @@ public:
     }
 
     static constexpr size_t decodingSize() {
-        return ProgramSettings::STATUS_JSON_BUFFER_SIZE;
+        return encodingSize();
     }
 
     /** ────────────────────────────────────────────────────────────────────────────
@@ -137,8 +233,13 @@ public:
         return "Status";
     }
 
+    // Members written by encodeJSON, plus the utc StatusGet adds. Strings are stored as
+    // pointers (keys and state/task names), so only the slots count.
+    static constexpr size_t ENCODED_MEMBERS = 20;
+
     static constexpr size_t encodingSize() {
-        return ProgramSettings::STATUS_JSON_BUFFER_SIZE;
+        // valves and valveCurrent hold at most one entry per valve
+        return JSON_OBJECT_SIZE(ENCODED_MEMBERS) + 2 * JSON_ARRAY_SIZE(ProgramSettings::MAX_VALVES);
     }
 
     bool encodeJSON(const JsonVariant & dest) const override {
@@ -146,6 +247,9 @@ public:
         JsonArray doc_valves = dest.createNestedArray(VALVES);
         copyArray(valves.data(), valves.size(), doc_valves);
 
+        JsonArray doc_current = dest.createNestedArray(VALVE_CURRENT);
+        copyArray(currentValves.data(), currentValves.size(), doc_current);
+
         // clang-format off
 		return dest[VALVES_COUNT].set(valves.size()) 
 			&& dest[SENSOR_PRESSURE].set(pressure)
@@ -156,8 +260,14 @@ public:
 			&& dest[SENSOR_FLOW].set(waterFlow) 
 			&& dest[CURRENT_TASK].set(currentTaskName)
 			&& dest[CURRENT_STATE].set(currentStateName) 
+			&& dest[CURRENT_STATE_ID].set(currentStateId) 
             && dest[LOW_BATTERY].set(isBatteryLow())
-            && dest[SAMPLE_VOLUME].set(sampleVolume);
+            && dest[SAMPLE_VOLUME].set(sampleVolume)
+            && dest[TASK_START_LATENCY].set(taskStartLatency)
+            && dest[START_FLOW_LATENCY].set(startFlowLatency)
+            && dest[WAKE_TO_READY].set(wakeToReady)
+            && dest[START_JITTER].set(startJitter)
+            && dest[MAX_START_JITTER].set(maxStartJitter);
         // clang-format on
     }
 
@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include <KPFoundation.hpp>
+#include <KPStateMachine.hpp>
+#include "SD.h"
+
+#include <Application/Constants.hpp>
+#include <StateControllers/StateControllerBase.hpp>
+#include <Utilities/RingLog.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: T R A N S I T I O N   T R A C E : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────────
+//
+// Ring log of the last state transitions of the tracked state machines.
+// Events are 8 bytes; the oldest ones are overwritten once the log is full. Events
+// that have not been written to SD yet are appended to the trace file with each sample
+// record.
+//
+struct TransitionEvent {
+    static constexpr uint8_t UNKNOWN = 0x3F;
+
+    uint32_t time;        // millis()
+    uint8_t machine : 2;  // Index of the machine in the order it was tracked
+    uint8_t from : 6;     // State id, UNKNOWN before the first transition
+    uint8_t to;           // State id
+    int8_t code;          // Exit code of the previous state (-1: panic)
+    int8_t valve;         // First current valve, -1 if none
+};
+
+static_assert(sizeof(TransitionEvent) == 8, "Trace events must stay 8 bytes");
+
+class TransitionTrace : public KPStateMachineObserver {
+private:
+    struct Machine {
+        const IndexedStateMachine * sm;
+        uint8_t current;
+    };
+
+    std::vector<Machine> machines;
+    RingLog<TransitionEvent, TraceSettings::CAPACITY> events;
+    const std::vector<int> & currentValves;
+
+    const char * KPStateMachineObserverName() const override {
+        return "TransitionTrace-KPStateMachine Observer";
+    }
+
+    void stateDidBegin(const KPState * current) override {
+        for (size_t m = 0; m < machines.size(); m++) {
+            const int to = machines[m].sm->indexOf(current);
+            if (to < 0) {
+                continue;
+            }
+
+            TransitionEvent event;
+            event.time    = millis();
+            event.machine = m;
+            event.from    = machines[m].current;
+            event.to      = to;
+            event.code    = machines[m].sm->lastExitCode();
+            event.valve   = currentValves.empty() ? -1 : currentValves.front();
+            events.push(event);
+
+            machines[m].current = to;
+            return;
+        }
+    }
+
+public:
+    explicit TransitionTrace(const std::vector<int> & currentValves)
+        : currentValves(currentValves) {}
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Record the transitions of the given machine. The machine index stored in
+     *  the events is the number of machines tracked before it.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void track(IndexedStateMachine & sm) {
+        machines.push_back({&sm, TransitionEvent::UNKNOWN});
+        sm.addObserver(this);
+    }
+
+    size_t numberOfEvents() const {
+        return events.size();
+    }
+
+    // Unsaved events overwritten before they could be written to SD
+    uint32_t numberOfDroppedEvents() const {
+        return events.numberOfDropped();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Visit the events from the oldest to the newest
+     *
+     *  @param last Only visit the newest `last` events
+     *  @param visit Called with each event
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename Visitor>
+    void forEach(size_t last, Visitor && visit) const {
+        events.forEach(last, std::forward<Visitor>(visit));
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor && visit) const {
+        events.forEach(std::forward<Visitor>(visit));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Append the events not saved yet to the trace file as CSV rows
+     *  (millis, machine, from, to, code, valve)
+     *
+     *  @param filename Path of the trace file on the SD card
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writeUnsaved(const char * filename) {
+        if (!events.numberOfUnsaved()) {
+            return;
+        }
+
+        File file = SD.open(filename, FILE_WRITE);
+        events.forEachUnsaved([&file](const TransitionEvent & e) {
+            KPStringBuilder<64> row{e.time, ",", int(e.machine), ",", int(e.from), ",", int(e.to), ",",
+                                    int(e.code), ",", int(e.valve)};
+            file.println(row);
+        });
+
+        file.close();
+    }
+};
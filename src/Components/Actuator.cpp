@@ -0,0 +1,35 @@
+#include "Components/Actuator.hpp"
+
+Actuator * Actuator::instance = nullptr;
+
+// TC3 as a 16-bit counter at 48 MHz / 64, match-frequency mode with CC0 set for 1 kHz
+void Actuator::startTimer() {
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TCC2_TC3;
+    while (GCLK->STATUS.bit.SYNCBUSY) {}
+
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV64;
+    TC3->COUNT16.CC[0].reg = VARIANT_MCK / 64 / ActuatorSettings::TICK_RATE - 1;
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY) {}
+
+    TC3->COUNT16.INTFLAG.reg  = TC_INTFLAG_MC0;
+    TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+    NVIC_SetPriority(TC3_IRQn, ActuatorSettings::IRQ_PRIORITY);
+    NVIC_EnableIRQ(TC3_IRQn);
+
+    TC3->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY) {}
+    running = true;
+}
+
+void Actuator::stopTimer() {
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY) {}
+    TC3->COUNT16.INTENCLR.reg = TC_INTENCLR_MC0;
+    NVIC_DisableIRQ(TC3_IRQn);
+    running = false;
+}
+
+void TC3_Handler() {
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    Actuator::tick();
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include <KPFoundation.hpp>
+#include "SD.h"
+
+#include <Application/Constants.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Components/I2CBus.hpp>
+#include <Components/PWMDriver.hpp>
+#include <Utilities/RingLog.hpp>
+
+//
+// ────────────────────────────────────────────────────────── I ──────────
+//   :::::: A C T U A T O R : :  :   :    :     :        :          :
+// ────────────────────────────────────────────────────────────────────
+//
+// Pump commands with a due time (millis), sent by a 1 kHz TC3 interrupt instead of the
+// main loop, so a phase ends on time even when the loop is busy with the SD card or an
+// HTTP request. Wire master mode is polled on the SAMD21, so the interrupt can run a
+// transaction itself as long as the main loop is not in the middle of one: every Wire
+// user holds an I2CBus::Lock. If the bus is locked, the command goes out as soon as the
+// outermost lock is released, which bounds the skew by the longest locked section
+// rather than by the loop. The timer only runs while commands are pending or a watcher
+// is set (the overpressure guard polls the pressure sensor from it while pumps run), so
+// it does not keep waking the loop.
+//
+// Every command sent is recorded with its skew (ms late). The pump arbiter collects the
+// records to update its bookkeeping and the app appends them to the skew log.
+//
+struct Actuation {
+    unsigned long due;
+    uint32_t pins;  // Bit mask of pump channels
+    uint16_t pulse;
+};
+
+struct ActuationRecord {
+    unsigned long due;
+    uint32_t pins;
+    uint16_t pulse;
+    uint16_t skew;  // ms
+};
+
+class Actuator {
+private:
+    PWMDriver & pwm;
+
+    // Pending commands, sorted by due time
+    std::array<Actuation, ActuatorSettings::CAPACITY> pending;
+    volatile size_t size = 0;
+
+    // Written by the interrupt: read with interrupts masked
+    RingLog<ActuationRecord, ActuatorSettings::LOG_CAPACITY> records;
+    volatile size_t uncollected = 0;
+
+    static Actuator * instance;
+    bool running = false;
+    void (*volatile watcher)() = nullptr;
+
+    static bool isBefore(unsigned long a, unsigned long b) {
+        return long(a - b) < 0;
+    }
+
+    void record(const Actuation & command, unsigned long now) {
+        const unsigned long skew = now - command.due;
+        records.push({command.due, command.pins, command.pulse, uint16_t(min(skew, 0xFFFFul))});
+        uncollected = min(uncollected + 1, records.capacity());
+
+        lastSkew = skew;
+        if (skew > maxSkew) {
+            maxSkew = skew;
+        }
+    }
+
+    void startTimer();
+    void stopTimer();
+
+public:
+    volatile unsigned long lastSkew = 0;
+    volatile unsigned long maxSkew  = 0;
+
+    explicit Actuator(PWMDriver & pwm) : pwm(pwm) {
+        instance = this;
+        I2CBus::onRelease(&Actuator::drain);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Send the pulse width to the pumps at the given time
+     *
+     *  @param due millis() at which to send the command
+     *  @param pins Pump channels
+     *  @param pulse Pulse width in µs
+     *  @return false if the queue is full
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool schedule(unsigned long due, const std::vector<int> & pins, int pulse) {
+        const uint32_t mask = pwm.maskOf(pins);
+        if (!mask) {
+            return true;
+        }
+
+        noInterrupts();
+        if (size == pending.size()) {
+            interrupts();
+            return false;
+        }
+
+        size_t i = size;
+        for (; i > 0 && isBefore(due, pending[i - 1].due); i--) {
+            pending[i] = pending[i - 1];
+        }
+
+        pending[i] = {due, mask, uint16_t(pulse)};
+        size       = size + 1;
+        if (!running) {
+            startTimer();
+        }
+
+        interrupts();
+        return true;
+    }
+
+    // Drop the pending commands for the given pumps, e.g. when the loop sends a newer one
+    void cancel(const std::vector<int> & pins) {
+        const uint32_t mask = pwm.maskOf(pins);
+        noInterrupts();
+        size_t kept = 0;
+        for (size_t i = 0; i < size; i++) {
+            pending[i].pins &= ~mask;
+            if (pending[i].pins) {
+                pending[kept++] = pending[i];
+            }
+        }
+
+        size = kept;
+        interrupts();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Run a handler on every timer tick, before the due commands are sent
+     *
+     *  @param handler Called from the interrupt, nullptr to stop
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void watch(void (*handler)()) {
+        noInterrupts();
+        watcher = handler;
+        if (handler && !running) {
+            startTimer();
+        } else if (!handler && !size && running) {
+            stopTimer();
+        }
+
+        interrupts();
+    }
+
+    void cancelAll() {
+        noInterrupts();
+        size = 0;
+        interrupts();
+    }
+
+    size_t numberOfPendingCommands() const {
+        return size;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Send the commands that are due. Called by the timer interrupt when the
+     *  bus is free, when a bus lock is released after the interrupt found it locked,
+     *  and by the pump arbiter.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void service() {
+        I2CBus::Lock lock;
+        const unsigned long now = millis();
+        while (size && !isBefore(now, pending[0].due)) {
+            noInterrupts();
+            const Actuation command = pending[0];
+            for (size_t i = 1; i < size; i++) {
+                pending[i - 1] = pending[i];
+            }
+
+            size = size - 1;
+            interrupts();
+
+            pwm.writePumpsVariable(command.pins, command.pulse);
+            record(command, now);
+        }
+
+        if (!size && !watcher && running) {
+            stopTimer();
+        }
+    }
+
+    // Timer interrupt: run the watcher, then send the due commands unless the main loop
+    // holds the bus
+    static void tick() {
+        if (instance->watcher) {
+            instance->watcher();
+        }
+
+        if (!instance->size || isBefore(millis(), instance->pending[0].due)) {
+            return;
+        }
+
+        if (I2CBus::isLocked()) {
+            I2CBus::post();
+        } else {
+            instance->service();
+        }
+
+        // The loop collects the records
+        DeadlineScheduler::interrupt();
+    }
+
+    static void drain() {
+        instance->service();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Visit the records not collected yet, from the oldest to the newest
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename Visitor>
+    void collect(Visitor && visit) {
+        noInterrupts();
+        records.forEach(uncollected, visit);
+        uncollected = 0;
+        interrupts();
+    }
+
+    // Records overwritten before they could be written to SD
+    uint32_t numberOfDroppedRecords() const {
+        return records.numberOfDropped();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Append the records not saved yet to the skew log as CSV rows
+     *  (due ms, pump mask, pulse µs, skew ms)
+     *
+     *  @param filename Path of the skew log on the SD card
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writeUnsaved(const char * filename) {
+        // Copy the unsaved records first: the SD card is too slow to mask interrupts
+        std::array<ActuationRecord, ActuatorSettings::LOG_CAPACITY> unsaved;
+        size_t count = 0;
+        noInterrupts();
+        records.forEachUnsaved([&](const ActuationRecord & r) { unsaved[count++] = r; });
+        interrupts();
+        if (!count) {
+            return;
+        }
+
+        File file = SD.open(filename, FILE_WRITE);
+        for (size_t i = 0; i < count; i++) {
+            const ActuationRecord & r = unsaved[i];
+            KPStringBuilder<64> row{r.due, ",", r.pins, ",", r.pulse, ",", r.skew};
+            file.println(row);
+        }
+
+        file.close();
+    }
+};
@@ -0,0 +1,180 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <ArduinoJson.h>
+#include <TimeLib.h>
+
+#include <Application/Constants.hpp>
+#include <Utilities/JsonEncodableDecodable.hpp>
+
+//
+// ──────────────────────────────────────────────────────────── I ──────────
+//   :::::: C L O C K   D R I F T : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────
+//
+// Time discipline model of the two clocks of the unit, persisted in drift.js:
+//
+//  - The PCF8523 against UTC. Every /api/rtc/update reports how far the RTC was off
+//    before being set; once the reports span a week, the residual drift is turned into
+//    steps of the PCF8523 offset register (4.34 ppm each in two-hour mode). A drift
+//    within the measurement error plus one step keeps the window growing instead, so
+//    the register does not dither on noise.
+//  - millis() against the RTC. RTC countdown interrupts fire on second boundaries, so
+//    two of them with millis() still running in between give its drift; millisUntil
+//    corrects for it and the TimeLib resync interval grows as the drift gets known.
+//
+class ClockDrift : public JsonEncodable, public JsonDecodable, public Printable {
+public:
+    // PCF8523 offset register, -64..63
+    int rtcOffset = 0;
+    // Residual RTC drift (ppm, positive when the RTC runs slow) at the last calibration
+    float rtcDrift = 0;
+    // Start of the current calibration window and seconds the RTC was set forward since
+    time_t reference = 0;
+    long correction  = 0;
+
+    // millis() drift (ppm, positive when millis() runs fast)
+    float millisDrift   = 0;
+    bool hasMillisDrift = false;
+
+private:
+    // Last RTC interrupt with millis() running since
+    time_t alignedEpoch         = 0;
+    unsigned long alignedMillis = 0;
+    bool aligned                = false;
+
+public:
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief The RTC is about to be set to UTC
+     *
+     *  @param utc Reference time
+     *  @param rtcEpoch RTC time at that moment
+     *  @return true if the offset register has to be updated
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool utcDidSync(time_t utc, time_t rtcEpoch) {
+        if (!reference) {
+            reference = utc;
+            return false;
+        }
+
+        correction += long(utc - rtcEpoch);
+        const long period = long(utc - reference);
+        if (period < ClockSettings::MIN_CALIBRATION_PERIOD) {
+            return false;
+        }
+
+        rtcDrift = correction * 1e6f / period;
+        const float resolution = ClockSettings::SYNC_RESOLUTION * 1e6f / period;
+        if (fabsf(rtcDrift) <= resolution + ClockSettings::OFFSET_STEP) {
+            return false;
+        }
+
+        const int offset = constrain(rtcOffset + int(lroundf(rtcDrift / ClockSettings::OFFSET_STEP)),
+                                     -64, 63);
+        reference  = utc;
+        correction = 0;
+        if (offset == rtcOffset) {
+            return false;
+        }
+
+        rtcOffset = offset;
+        return true;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief An RTC interrupt marked the start of the given second
+     *
+     *  @param epoch RTC time
+     *  @param ms millis() when the interrupt fired
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void secondDidStart(time_t epoch, unsigned long ms) {
+        const long period = long(epoch - alignedEpoch);
+        if (aligned && period < ClockSettings::MIN_MILLIS_PERIOD) {
+            return;  // Keep the longer baseline
+        }
+
+        if (aligned) {
+            const float expected = secsToMillis(period);
+            const float measured = (float(ms - alignedMillis) - expected) * 1e6f / expected;
+            millisDrift          = hasMillisDrift ? (millisDrift + measured) / 2 : measured;
+            hasMillisDrift       = true;
+        }
+
+        alignedEpoch  = epoch;
+        alignedMillis = ms;
+        aligned       = true;
+    }
+
+    // millis() stopped (standby) or jumped: the next interrupt starts a new baseline
+    void millisDidStop() {
+        aligned = false;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief millis() elapsed over the given real milliseconds
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long scale(long ms) const {
+        return ms + lroundf(ms * millisDrift / 1e6f);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Milliseconds between TimeLib resyncs keeping the TimeLib clock within
+     *  ClockSettings::ERROR_BUDGET of the RTC
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    unsigned long resyncInterval() const {
+        using namespace ClockSettings;
+        if (!hasMillisDrift) {
+            return MIN_RESYNC;
+        }
+
+        const float ppm = max(fabsf(millisDrift), DRIFT_FLOOR);
+        return constrain((unsigned long) (ERROR_BUDGET * 1e6f / ppm), MIN_RESYNC, MAX_RESYNC);
+    }
+
+#pragma region JSONDECODABLE
+    static const char * decoderName() {
+        return "ClockDrift";
+    }
+
+    static constexpr size_t decodingSize() {
+        return ClockSettings::JSON_BUFFER_SIZE;
+    }
+
+    void decodeJSON(const JsonVariant & src) override {
+        using namespace ClockKeys;
+        rtcOffset      = constrain(src[RTC_OFFSET] | rtcOffset, -64, 63);
+        rtcDrift       = src[RTC_DRIFT] | 0.0f;
+        reference      = src[REFERENCE] | 0L;
+        correction     = src[CORRECTION] | 0L;
+        hasMillisDrift = src.containsKey(MILLIS_DRIFT);
+        millisDrift    = src[MILLIS_DRIFT] | 0.0f;
+    }
+#pragma endregion
+#pragma region JSONENCODABLE
+    static const char * encoderName() {
+        return "ClockDrift";
+    }
+
+    static constexpr size_t encodingSize() {
+        return ClockSettings::JSON_BUFFER_SIZE;
+    }
+
+    bool encodeJSON(const JsonVariant & dst) const override {
+        using namespace ClockKeys;
+        // clang-format off
+        return dst[RTC_OFFSET].set(rtcOffset)
+            && dst[RTC_DRIFT].set(rtcDrift)
+            && dst[REFERENCE].set(reference)
+            && dst[CORRECTION].set(correction)
+            && (!hasMillisDrift || dst[MILLIS_DRIFT].set(millisDrift));
+        // clang-format on
+    }
+#pragma endregion
+#pragma region PRINTABLE
+    size_t printTo(Print & printer) const override {
+        StaticJsonDocument<encodingSize()> doc;
+        JsonVariant object = doc.to<JsonVariant>();
+        encodeJSON(object);
+        return serializeJsonPretty(object, printer);
+    }
+#pragma endregion
+};
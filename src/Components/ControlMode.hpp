@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Quantity held by the FlowController
+enum class ControlMode : uint8_t { off, pressure, flow };
+
+inline const char * controlModeName(ControlMode mode) {
+    return mode == ControlMode::pressure ? "pressure" : mode == ControlMode::flow ? "flow" : "off";
+}
+
+inline ControlMode parseControlMode(const char * name) {
+    if (name && strcmp(name, "pressure") == 0) {
+        return ControlMode::pressure;
+    }
+
+    return name && strcmp(name, "flow") == 0 ? ControlMode::flow : ControlMode::off;
+}
@@ -0,0 +1,3 @@
+#include "Components/DeadlineScheduler.hpp"
+
+volatile bool DeadlineScheduler::interrupted = false;
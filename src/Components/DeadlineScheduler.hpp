@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <KPFoundation.hpp>
+#include <Application/Constants.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: D E A D L I N E   S C H E D U L E R : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────────────
+//
+// Components that wait for a point in time register it here instead of checking millis()
+// on every loop. Once the components are updated, the main loop sleeps the CPU (WFI) until
+// the earliest deadline, an external interrupt, or the given cap, whichever comes first.
+// SysTick still wakes the core every millisecond, so millis() stays valid while asleep.
+//
+class DeadlineScheduler {
+private:
+    std::array<unsigned long, DeadlineSettings::CAPACITY> deadlines;
+    size_t size = 0;
+
+    unsigned long asleep = 0;  // Total ms spent in WFI
+    static volatile bool interrupted;
+
+    static bool isBefore(unsigned long a, unsigned long b) {
+        return long(a - b) < 0;
+    }
+
+    // Drop the deadlines that are due
+    void expire(unsigned long time) {
+        size_t kept = 0;
+        for (size_t i = 0; i < size; i++) {
+            if (isBefore(time, deadlines[i])) {
+                deadlines[kept++] = deadlines[i];
+            }
+        }
+
+        size = kept;
+    }
+
+public:
+    static DeadlineScheduler & sharedInstance() {
+        static DeadlineScheduler instance;
+        return instance;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Make sure the main loop runs at the given time (millis). When full, the
+     *  latest deadline is replaced since the earlier ones wake the loop anyway.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void wakeAt(unsigned long time) {
+        if (size < deadlines.size()) {
+            deadlines[size++] = time;
+            return;
+        }
+
+        size_t latest = 0;
+        for (size_t i = 1; i < size; i++) {
+            if (isBefore(deadlines[latest], deadlines[i])) {
+                latest = i;
+            }
+        }
+
+        if (isBefore(time, deadlines[latest])) {
+            deadlines[latest] = time;
+        }
+    }
+
+    void wakeIn(unsigned long ms) {
+        wakeAt(millis() + ms);
+    }
+
+    // Called from interrupt handlers: ends the current sleep right away
+    static void interrupt() {
+        interrupted = true;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Sleep until the earliest deadline or an interrupt
+     *
+     *  @param cap Longest sleep in ms (e.g. the server poll interval)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void sleep(unsigned long cap) {
+        const unsigned long start = millis();
+        expire(start);
+
+        unsigned long until = start + cap;
+        for (size_t i = 0; i < size; i++) {
+            if (isBefore(deadlines[i], until)) {
+                until = deadlines[i];
+            }
+        }
+
+        interrupted = false;
+        while (!interrupted && isBefore(millis(), until)) {
+            __WFI();
+        }
+
+        asleep += millis() - start;
+    }
+
+    unsigned long timeAsleep() const {
+        return asleep;
+    }
+
+    size_t numberOfDeadlines() const {
+        return size;
+    }
+};
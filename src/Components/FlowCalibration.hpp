@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+
+#include <KPFoundation.hpp>
+#include <ArduinoJson.h>
+
+#include <Application/Constants.hpp>
+#include <Utilities/JsonEncodableDecodable.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: F L O W   C A L I B R A T I O N : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────
+//
+// Measured flow of each pump channel, loaded from calib.js:
+//
+//  {
+//    "pressureCoefficient": 0.0004,
+//    "channels": [
+//      {"pressure": 1013, "points": [[1500, 0], [1650, 4.1], [1800, 9.6]]},
+//      ...
+//    ]
+//  }
+//
+// Each channel maps pulse widths (µs, ascending) to flow (mL/s) measured at the given
+// pressure (mbar); in between, the flow is interpolated linearly. Away from that pressure
+// the flow is scaled by 1 - pressureCoefficient * (pressure - calibration pressure).
+// Channels without points have no estimate.
+//
+class FlowCalibration : public JsonDecodable {
+public:
+    struct Point {
+        uint16_t pulse;
+        float flow;
+    };
+
+    struct Channel {
+        float pressure = 0;
+        uint8_t numberOfPoints = 0;
+        std::array<Point, FlowSettings::MAX_POINTS> points;
+    };
+
+    float pressureCoefficient = 0;
+    std::array<Channel, PumpSettings::CHANNELS> channels;
+
+    bool isCalibrated(int channel) const {
+        return channel >= 0 && channel < int(channels.size()) && channels[channel].numberOfPoints;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Estimated flow of a pump
+     *
+     *  @param channel Pump channel
+     *  @param pulse Pulse width in µs
+     *  @param pressure Current pressure in mbar
+     *  @return float Flow in mL/s, 0 if the channel is not calibrated
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    float flowRate(int channel, int pulse, float pressure) const {
+        if (!isCalibrated(channel)) {
+            return 0;
+        }
+
+        const Channel & c = channels[channel];
+        size_t i          = 0;
+        while (i + 1 < c.numberOfPoints && c.points[i + 1].pulse <= pulse) {
+            i++;
+        }
+
+        float flow = c.points[i].flow;
+        if (i + 1 < c.numberOfPoints && pulse > c.points[i].pulse) {
+            const Point & a = c.points[i];
+            const Point & b = c.points[i + 1];
+            flow            = a.flow + (b.flow - a.flow) * (pulse - a.pulse) / (b.pulse - a.pulse);
+        }
+
+        return max(flow * (1 - pressureCoefficient * (pressure - c.pressure)), 0.0f);
+    }
+
+#pragma region JSONDECODABLE
+    static const char * decoderName() {
+        return "FlowCalibration";
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Size of a full calib.js: every channel with MAX_POINTS points. Keys are
+     *  copied from the file stream, so their characters are counted as well.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    static constexpr size_t decodingSize() {
+        using namespace FlowKeys;
+        return jsonObjectSize(PRESSURE_COEFFICIENT, CHANNELS) + JSON_ARRAY_SIZE(PumpSettings::CHANNELS)
+             + PumpSettings::CHANNELS
+                   * (jsonObjectSize(PRESSURE, POINTS) + JSON_ARRAY_SIZE(FlowSettings::MAX_POINTS)
+                      + FlowSettings::MAX_POINTS * JSON_ARRAY_SIZE(2));
+    }
+
+    void decodeJSON(const JsonVariant & source) override {
+        using namespace FlowKeys;
+        pressureCoefficient = source[PRESSURE_COEFFICIENT] | 0.0f;
+
+        JsonArrayConst source_channels = source[CHANNELS].as<JsonArrayConst>();
+        for (size_t i = 0; i < channels.size(); i++) {
+            Channel & channel      = channels[i];
+            JsonVariantConst entry = source_channels[i];
+            channel.pressure       = entry[PRESSURE] | 0.0f;
+            channel.numberOfPoints = 0;
+            for (JsonArrayConst point : entry[POINTS].as<JsonArrayConst>()) {
+                if (channel.numberOfPoints == channel.points.size()) {
+                    break;
+                }
+
+                // Points must be in ascending pulse width
+                const uint16_t pulse = point[0] | 0;
+                if (channel.numberOfPoints && pulse <= channel.points[channel.numberOfPoints - 1].pulse) {
+                    KPStringBuilder<80> error("FlowCalibration: channel ", i, " is not ascending");
+                    halt(TRACE, error);
+                }
+
+                channel.points[channel.numberOfPoints++] = {pulse, point[1] | 0.0f};
+            }
+        }
+    }
+#pragma endregion
+};
+
+// The document is on the stack while calib.js is loaded
+static_assert(FlowCalibration::decodingSize() <= FlowSettings::MAX_JSON_BUFFER_SIZE,
+    "calib.js does not fit the stack budget; lower MAX_POINTS");
@@ -0,0 +1,190 @@
+#pragma once
+#include <vector>
+
+#include <KPFoundation.hpp>
+
+#include <Application/Config.hpp>
+#include <Application/Constants.hpp>
+#include <Application/Status.hpp>
+#include <Components/ControlMode.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Components/I2CBus.hpp>
+#include <Components/PressureSensor.hpp>
+#include <Components/PumpArbiter.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: F L O W   C O N T R O L L E R : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────
+//
+// PID loop on the pulse width of the sampling pumps. It holds either the pressure above
+// the one read before the pumps started (mbar), or the estimated flow per pump (mL/s, see
+// FlowEstimator). As the filter loads up, the pumps speed up to keep the flow.
+//
+// Ticks are due every config.controlPeriod ms from the start, whatever the loop is busy
+// with; the deadline wakes the loop and the pressure sensor reads at the same rate while
+// the loop runs. The controller engages once the pumps are done ramping up, starting
+// from their pulse width (bumpless), and writes without ramps so it sees its own effect.
+// The derivative acts on the measurement to avoid kicks, and the integral only grows
+// while the output is not saturated in that direction.
+//
+class FlowController : public KPComponent {
+private:
+    PumpArbiter & pumps;
+    PressureSensor & sensor;
+    const Status & status;
+
+    std::vector<int> pins;
+    unsigned long until = 0;  // End of the phase: the pumps are stopped by then
+    bool running = false;
+    bool engaged = false;
+
+    float baseline    = 0;  // Pressure before the pumps started
+    bool hasBaseline  = false;  // Read by holdBaseline before priming
+    float bias        = PumpSettings::FORWARDS;  // Pulse width when the loop engaged
+    float integral    = 0;                       // µs
+    float measurement = 0;
+    unsigned long nextTick = 0;
+
+    float measure() const {
+        if (mode == ControlMode::pressure) {
+            return status.pressure - baseline;
+        }
+
+        return pins.empty() ? 0 : status.waterFlow / pins.size();
+    }
+
+    void tick(float dt) {
+        const float current = measure();
+        if (!engaged) {
+            measurement = current;
+            bias        = pumps.outputOf(pins.front());
+            output      = bias;
+            integral    = 0;
+            engaged     = true;
+            return;
+        }
+
+        const float error      = target - current;
+        const float derivative = (current - measurement) / dt;
+        measurement            = current;
+
+        const float candidate = integral + ki * error * dt;
+        const float unclamped = bias + kp * error + candidate - kd * derivative;
+        output                = constrain(unclamped, float(minPulse), float(maxPulse));
+        if (output == unclamped || (unclamped > output) != (error > 0)) {
+            integral = candidate;
+        }
+
+        pumps.writeAllVariable(pins, lroundf(output), false);
+    }
+
+public:
+    ControlMode mode = ControlMode::off;
+    float target     = 0;
+    float kp         = 0;
+    float ki         = 0;
+    float kd         = 0;
+    int minPulse     = PumpSettings::OFF;
+    int maxPulse     = PumpSettings::OFF + PumpSettings::FULL_THROTTLE;
+    float output     = PumpSettings::FORWARDS;
+    unsigned long period = ControlSettings::DEFAULT_PERIOD;
+
+    // Lateness (ms) of the last tick, the largest one, and ticks skipped for lateness
+    unsigned long jitter    = 0;
+    unsigned long maxJitter = 0;
+    uint32_t ticks          = 0;
+    uint32_t missedTicks    = 0;
+
+    FlowController(const char * name, PumpArbiter & pumps, PressureSensor & sensor,
+                   const Status & status)
+        : KPComponent(name), pumps(pumps), sensor(sensor), status(status) {}
+
+    void init(const Config & config) {
+        mode     = config.controlMode;
+        target   = config.controlTarget;
+        kp       = config.controlKp;
+        ki       = config.controlKi;
+        kd       = config.controlKd;
+        minPulse = config.controlMinPulse;
+        maxPulse = config.controlMaxPulse;
+        period   = config.controlPeriod;
+    }
+
+    bool isRunning() const {
+        return running;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Read the pressure baseline now, with the pumps still off, for the next
+     *  start(). Called before priming, which starts the pumps ahead of the phase.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void holdBaseline() {
+        baseline    = status.pressure;
+        hasBaseline = true;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start controlling the given pumps. Call before they are started so the
+     *  pressure baseline is read with the pumps still off, unless holdBaseline already
+     *  read it.
+     *
+     *  @param channels Pump channels
+     *  @param end millis() at which the phase stops the pumps; no correction is
+     *  written from then on
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void start(const std::vector<int> & channels, unsigned long end) {
+        if (mode == ControlMode::off || channels.empty()) {
+            hasBaseline = false;
+            return;
+        }
+
+        pins     = channels;
+        until    = end;
+        baseline = hasBaseline ? baseline : status.pressure;
+        engaged  = false;
+        running  = true;
+        nextTick = millis() + period;
+        sensor.requestInterval(period);
+        DeadlineScheduler::sharedInstance().wakeAt(nextTick);
+    }
+
+    void stop() {
+        hasBaseline = false;
+        if (running) {
+            running = false;
+            sensor.releaseInterval(period);
+        }
+    }
+
+    void update() override {
+        if (!running) {
+            return;
+        }
+
+        // Holding the bus, the timed stop of the pumps cannot come between the check
+        // and a correction and be undone by it
+        I2CBus::Lock lock;
+        const unsigned long now = millis();
+        if (long(now - until) >= 0) {
+            return stop();
+        }
+
+        if (long(now - nextTick) < 0) {
+            return;
+        }
+
+        // Stay on the grid of the start: a late tick does not shift the next ones
+        jitter    = now - nextTick;
+        maxJitter = max(maxJitter, jitter);
+        const unsigned long skipped = jitter / period;
+        missedTicks += skipped;
+        nextTick += (skipped + 1) * period;
+        ticks++;
+        DeadlineScheduler::sharedInstance().wakeAt(nextTick);
+
+        if (!pumps.isRamping()) {
+            tick((skipped + 1) * period / 1000.0f);
+        }
+    }
+};
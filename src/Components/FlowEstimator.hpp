@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+
+#include <KPFoundation.hpp>
+
+#include <Application/Constants.hpp>
+#include <Application/Status.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Components/FlowCalibration.hpp>
+#include <Components/PumpArbiter.hpp>
+
+//
+// ────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: F L O W   E S T I M A T O R : :  :   :    :     :        :          :
+// ────────────────────────────────────────────────────────────────────────────
+//
+// Integrates the calibrated flow of the sampling pumps into status.sampleVolume, using
+// the pulse width each pump is actually at (ramps included) and the last pressure
+// reading. With a target volume, the loop is woken up when the target is expected to be
+// reached so the sample can stop right then.
+//
+class FlowEstimator : public KPComponent {
+private:
+    const FlowCalibration & calibration;
+    const PumpArbiter & pumps;
+    Status & status;
+
+    std::vector<int> pins;
+    float target               = 0;
+    unsigned long lastUpdate   = 0;
+    bool running               = false;
+
+public:
+    FlowEstimator(const char * name, const FlowCalibration & calibration,
+                  const PumpArbiter & pumps, Status & status)
+        : KPComponent(name), calibration(calibration), pumps(pumps), status(status) {}
+
+    // Whether every one of the pumps has a calibration table
+    bool canEstimate(const std::vector<int> & channels) const {
+        return !channels.empty()
+            && std::all_of(channels.begin(), channels.end(),
+                           [this](int c) { return calibration.isCalibrated(c); });
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start integrating the flow of the given pumps from 0
+     *
+     *  @param channels Pump channels
+     *  @param volume Target volume in mL, 0 for none
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void start(const std::vector<int> & channels, float volume) {
+        pins                = channels;
+        target              = volume;
+        lastUpdate          = millis();
+        running             = true;
+        status.sampleVolume = 0;
+        status.waterFlow    = 0;
+    }
+
+    void stop() {
+        update();
+        running          = false;
+        status.waterFlow = 0;
+    }
+
+    bool didReachTarget() const {
+        return target > 0 && status.sampleVolume >= target;
+    }
+
+    void update() override {
+        if (!running) {
+            return;
+        }
+
+        const unsigned long now = millis();
+        float flow              = 0;
+        for (auto pin : pins) {
+            flow += calibration.flowRate(pin, pumps.outputOf(pin), status.pressure);
+        }
+
+        // Rectangle rule with the flow at the end of the interval: pumps ramp up, so this
+        // slightly overestimates and errs on stopping early rather than overfilling
+        status.sampleVolume += flow * (now - lastUpdate) / 1000;
+        status.waterFlow = flow;
+        lastUpdate       = now;
+
+        unsigned long next = FlowSettings::INTEGRATION_INTERVAL;
+        if (target > 0 && flow > 0 && !didReachTarget()) {
+            next = min(next, (unsigned long) ceilf((target - status.sampleVolume) * 1000 / flow));
+        }
+
+        DeadlineScheduler::sharedInstance().wakeIn(next);
+    }
+};
@@ -0,0 +1,5 @@
+#include "Components/I2CBus.hpp"
+
+volatile uint8_t I2CBus::depth = 0;
+volatile bool I2CBus::posted   = false;
+void (*I2CBus::drain)()        = nullptr;
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+//
+// ──────────────────────────────────────────────────────── I ──────────
+//   :::::: I 2 C   B U S : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────
+//
+// Lock shared by the main loop and the actuation interrupt. Wire is not reentrant, so
+// every main loop Wire user holds a Lock for the duration of its I2C transactions (and of
+// the shadow state that goes with them). Wire master mode is polled on the SAMD21, so an
+// interrupt handler may run transactions itself while the bus is not locked; if it is,
+// the handler posts its work with post() and the work runs as soon as the outermost Lock
+// is released. Locks nest, so the posted work can take them too.
+//
+class I2CBus {
+private:
+    static volatile uint8_t depth;
+    static volatile bool posted;
+    static void (*drain)();
+
+public:
+    struct Lock {
+        Lock() {
+            depth++;
+        }
+
+        ~Lock() {
+            if (--depth == 0 && posted) {
+                posted = false;
+                if (drain) {
+                    drain();
+                }
+            }
+        }
+
+        Lock(const Lock &) = delete;
+        Lock & operator=(const Lock &) = delete;
+    };
+
+    // Work run when the bus is released after an interrupt posted it
+    static void onRelease(void (*work)()) {
+        drain = work;
+    }
+
+    // Called from interrupt handlers that find the bus locked
+    static void post() {
+        posted = true;
+    }
+
+    static bool isLocked() {
+        return depth != 0;
+    }
+};
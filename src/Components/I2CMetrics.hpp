@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <stdint.h>
+
+//
+// ────────────────────────────────────────────────────────────── I ──────────
+//   :::::: I 2 C   M E T R I C S : :  :   :    :     :        :          :
+// ────────────────────────────────────────────────────────────────────────
+//
+// Bus health counters of the I2C transactions of a component, with a histogram of
+// their duration. Bin i counts transactions shorter than upperEdge(i) µs; the last bin
+// counts the rest.
+//
+struct I2CMetrics {
+    static constexpr size_t BINS = 7;
+
+    uint32_t transactions = 0;
+    uint32_t retries      = 0;
+    uint32_t nacks        = 0;  // Address or data not acknowledged
+    uint32_t timeouts     = 0;
+    uint32_t failures     = 0;  // Transactions that failed every retry
+    uint32_t skipped      = 0;  // Writes left out because the registers already held the value
+    std::array<uint32_t, BINS> histogram{};
+
+    static constexpr unsigned long upperEdge(size_t bin) {
+        return 100ul << bin;
+    }
+
+    void record(unsigned long duration) {
+        size_t bin = 0;
+        while (bin < BINS - 1 && duration >= upperEdge(bin)) {
+            bin++;
+        }
+
+        histogram[bin]++;
+        transactions++;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Count the error returned by Wire.endTransmission
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void recordError(uint8_t error) {
+        if (error == 2 || error == 3) {
+            nacks++;
+        } else if (error == 5) {
+            timeouts++;
+        }
+    }
+};
@@ -0,0 +1,3 @@
+#include "Components/OverpressureGuard.hpp"
+
+OverpressureGuard * OverpressureGuard::instance = nullptr;
@@ -0,0 +1,204 @@
+#pragma once
+#include <functional>
+
+#include <KPFoundation.hpp>
+#include <TimeLib.h>
+#include "SD.h"
+
+#include <Application/Config.hpp>
+#include <Application/Constants.hpp>
+#include <Components/Actuator.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Components/I2CBus.hpp>
+#include <Components/PressureSensor.hpp>
+#include <Components/PumpArbiter.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: O V E R P R E S S U R E   G U A R D : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────────
+//
+// Cuts every pump as soon as a reading reaches config.cutoffPressure (config.maxPressure
+// if no cutoff is set), then lets the app route the state machines to STOP through the
+// -1 exit code. The pump arbiter arms the guard synchronously, before it writes the first
+// pulse width other than neutral.
+//
+// While armed, the guard reads the sensor itself from the actuator's 1 kHz timer
+// interrupt, so the main loop being late (SD writes, HTTP requests) does not delay the
+// check. The interrupt cannot wait for a conversion, so a reading takes two ticks: start
+// a conversion every GuardSettings::INTERVAL ms, read it back
+// PressureSettings::CONVERSION_TIME later and check it. Each step waits for a free bus,
+// and the trip itself is PumpArbiter::cutoff: one all-off transaction per board. If the
+// pressure crosses the threshold right after a check, the pumps are off within
+//
+//     INTERVAL + CONVERSION_TIME + 2 ticks + 2 x the longest bus lock + the all-off
+//
+// The longest bus lock is the main loop's own sensor.read() (about 10 ms), so about
+// 85 ms at 100 kHz. maxBlindTime is the longest window between two checks (or the
+// arming and the first check) seen while armed; the latency of a trip runs from the
+// check before it to the pumps being off. The main loop then logs the event, brings the
+// pump bookkeeping up to date and calls the trip callback.
+//
+// Each event is appended to the overpressure log (epoch, pressure, threshold, µs from the
+// previous check to the pumps being off, µs from this reading to the pumps being off).
+//
+class OverpressureGuard : public KPComponent {
+private:
+    PumpArbiter & pumps;
+    Actuator & actuator;
+    PressureSensor & sensor;
+    std::function<void(float)> tripCallback;
+
+    static OverpressureGuard * instance;
+
+    // Shared with the timer interrupt
+    volatile bool armed                = false;
+    volatile bool converting           = false;
+    volatile bool tripped              = false;
+    volatile unsigned long lastCheck   = 0;  // µs, last check below the threshold or arming
+    volatile unsigned long lastRequest = 0;  // µs, start of the last conversion
+    volatile unsigned long detectedAt  = 0;  // µs, reading that tripped
+    volatile unsigned long offAt       = 0;  // µs, pumps off after it
+    volatile float tripPressure        = 0;
+
+    // Timer interrupt, every tick while armed
+    void poll() {
+        if (!armed || tripped || I2CBus::isLocked()) {
+            return;
+        }
+
+        const unsigned long now = micros();
+        if (!converting) {
+            if (now - lastRequest >= GuardSettings::INTERVAL * 1000) {
+                I2CBus::Lock lock;
+                sensor.startConversion();
+                lastRequest = now;
+                converting  = true;
+            }
+
+            return;
+        }
+
+        if (now - lastRequest < PressureSettings::CONVERSION_TIME) {
+            return;
+        }
+
+        float pressure = 0;
+        bool read      = false;
+        {
+            I2CBus::Lock lock;
+            read = sensor.readConversion(pressure);
+        }
+
+        // A failed read starts over at the next interval; the window keeps growing
+        converting = false;
+        if (!read) {
+            return;
+        }
+
+        const unsigned long checkedAt = micros();
+        const unsigned long blind     = checkedAt - lastCheck;
+        if (blind > maxBlindTime) {
+            maxBlindTime = blind;
+        }
+
+        if (pressure < threshold) {
+            lastCheck = checkedAt;
+            return;
+        }
+
+        pumps.cutoff();
+        offAt        = micros();
+        detectedAt   = checkedAt;
+        tripPressure = pressure;
+        tripped      = true;
+
+        // The loop logs the event
+        DeadlineScheduler::interrupt();
+    }
+
+    static void tick() {
+        instance->poll();
+    }
+
+    void didTrip() {
+        const float pressure = tripPressure;
+        pumps.allOff();
+        latency = offAt - lastCheck;
+        if (latency > maxLatency) {
+            maxLatency = latency;
+        }
+
+        events++;
+
+        println(RED("Overpressure: "), pressure, " >= ", threshold, ", pumps off within ", latency,
+                " µs of the previous check");
+        File file = SD.open(GuardSettings::FILE, FILE_WRITE);
+        KPStringBuilder<80> row{now(), ",", pressure, ",", threshold, ",", latency, ",", offAt - detectedAt};
+        file.println(row);
+        file.close();
+
+        disarm();
+        tripped = false;
+        if (tripCallback) {
+            tripCallback(pressure);
+        }
+    }
+
+    void disarm() {
+        if (armed) {
+            armed      = false;
+            converting = false;
+            actuator.watch(nullptr);
+        }
+    }
+
+public:
+    // Pressure (sensor unit, mbar) that cuts the pumps, 0 to disable
+    float threshold = 0;
+
+    uint32_t events                     = 0;
+    unsigned long latency               = 0;  // µs from the previous check to the pumps off, last event
+    unsigned long maxLatency            = 0;  // µs
+    volatile unsigned long maxBlindTime = 0;  // µs, longest window between two checks while armed
+
+    OverpressureGuard(const char * name, PumpArbiter & pumps, Actuator & actuator, PressureSensor & sensor)
+        : KPComponent(name), pumps(pumps), actuator(actuator), sensor(sensor) {
+        instance = this;
+    }
+
+    void init(const Config & config) {
+        threshold = config.cutoffPressure > 0 ? config.cutoffPressure : config.maxPressure;
+    }
+
+    // Called by the main loop after a trip, with the pressure that tripped
+    void onTrip(std::function<void(float)> callback) {
+        tripCallback = callback;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start checking the pressure. Called by the pump arbiter before a pump
+     *  starts; the first conversion starts at the next tick, from the pressure the pumps
+     *  start from.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void arm() {
+        if (threshold > 0 && !armed) {
+            noInterrupts();
+            lastCheck   = micros();
+            lastRequest = lastCheck - GuardSettings::INTERVAL * 1000;
+            converting  = false;
+            armed       = true;
+            interrupts();
+            actuator.watch(&OverpressureGuard::tick);
+        }
+    }
+
+    // Log a trip, or disarm once every pump is back at neutral
+    void update() override {
+        if (tripped) {
+            didTrip();
+        } else if (!pumps.isPumping()) {
+            disarm();
+        }
+    }
+};
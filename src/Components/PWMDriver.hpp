@@ -1,29 +1,124 @@
 #pragma once
 #include <KPFoundation.hpp>
 #include <Components/PumpStatus.hpp>
+#include <Components/I2CMetrics.hpp>
+#include <Components/I2CBus.hpp>
 #include <Adafruit_PWMServoDriver.h>
 #include <Wire.h>
+#include <algorithm>
+#include <vector>
+
+#include <Application/Constants.hpp>
 
 
 class PWMDriver : public KPComponent {
   public:
-    const int capacityPerDriver = 16;
+    static constexpr int numberOfDrivers   = 2;
+    static constexpr int capacityPerDriver = 16;
+
+  private:
+    // Channels per auto-increment burst: 4 registers each after the register address,
+    // within the 32 byte buffer of the smallest Wire implementations
+    static constexpr int burstChannels = 7;
+
+    static constexpr uint16_t UNKNOWN = 0xFFFF;
+
+    // Prescale of each board, read once after setPWMFreq instead of before every write
+    uint8_t prescale[2] = {0, 0};
+
+    // Last OFF register value written to each channel (ON is always 0), UNKNOWN until a
+    // write succeeds
+    uint16_t shadow[numberOfDrivers * capacityPerDriver];
+
+    // Set by cutoff(): pump writes are dropped until releaseCutoff()
+    volatile bool cut = false;
+
+    // PCA9685 ticks (of 4096 per period) of a pulse width
+    uint16_t ticks(int driver, int micros) const {
+      return uint32_t(micros) * (oscillator[driver] / 1000) / (1000UL * (prescale[driver] + 1));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  One I2C transaction to a board, retried up to I2CSettings::RETRIES times
+     *
+     *  @return true if it was acknowledged
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool transmit(int driver, const uint8_t * data, size_t length) {
+      for (int attempt = 0; attempt <= I2CSettings::RETRIES; attempt++) {
+        if (attempt) {
+          metrics.retries++;
+        }
+
+        const unsigned long start = micros();
+        Wire.beginTransmission(addresses[driver]);
+        Wire.write(data, length);
+        const uint8_t error = Wire.endTransmission();
+        metrics.record(micros() - start);
+        if (!error) {
+          return true;
+        }
+
+        metrics.recordError(error);
+      }
+
+      metrics.failures++;
+      return false;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Write the same pulse width to consecutive channels of a board. MODE1 has
+     *  auto-increment on (set by setPWMFreq), so each burst is one I2C transaction.
+     *  Channels of a failed burst are resent on their next write.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writeChannels(int driver, int first, int count, uint16_t off) {
+      uint8_t data[1 + 4 * burstChannels];
+      for (int burst = 0; burst < count; burst += burstChannels) {
+        const int channels = min(count - burst, burstChannels);
+        data[0] = PCA9685_LED0_ON_L + 4 * (first + burst);
+        for (int i = 0; i < channels; i++) {
+          data[1 + 4 * i] = 0;
+          data[2 + 4 * i] = 0;
+          data[3 + 4 * i] = off & 0xFF;
+          data[4 + 4 * i] = off >> 8;
+        }
+
+        const bool sent = transmit(driver, data, 1 + 4 * channels);
+        for (int i = 0; i < channels; i++) {
+          shadow[driver * capacityPerDriver + first + burst + i] = sent ? off : UNKNOWN;
+        }
+      }
+    }
+
+  public:
+    const uint8_t addresses[2]  = {0x41, 0x42};
+    const uint32_t oscillator[2] = {25000000, 27000000};
     int8_t* pumps;
     int pumpsCount;
+    // Microseconds from the last all-pumps-off command to every channel neutral, and
+    // the longest so far
+    unsigned long shutdownLatency    = 0;
+    unsigned long maxShutdownLatency = 0;
+    I2CMetrics metrics;
     //Adafruit_PWMServoDriver driver = Adafruit_PWMServoDriver();
-    Adafruit_PWMServoDriver drives[2] = {Adafruit_PWMServoDriver(0x41), Adafruit_PWMServoDriver(0x42)};
+    Adafruit_PWMServoDriver drives[2] = {Adafruit_PWMServoDriver(addresses[0]), Adafruit_PWMServoDriver(addresses[1])};
     PWMDriver(const char * name, int pumpCount) : KPComponent(name), pumpsCount(pumpCount) {
       pumps = new int8_t[pumpCount]();
+      std::fill_n(shadow, numberOfDrivers * capacityPerDriver, UNKNOWN);
     }
     void setup() override {
-      //driver.begin();
-      drives[0].begin();
-      drives[1].begin();
-      println("setting pwm");
-      drives[0].setOscillatorFrequency(25000000);
-      drives[1].setOscillatorFrequency(27000000);
-      drives[0].setPWMFreq(200);
-      drives[1].setPWMFreq(200);
+      {
+        I2CBus::Lock lock;
+        //driver.begin();
+        drives[0].begin();
+        drives[1].begin();
+        println("setting pwm");
+        drives[0].setOscillatorFrequency(oscillator[0]);
+        drives[1].setOscillatorFrequency(oscillator[1]);
+        drives[0].setPWMFreq(200);
+        drives[1].setPWMFreq(200);
+        prescale[0] = drives[0].readPrescale();
+        prescale[1] = drives[1].readPrescale();
+      }
       delay(10);
       //drives[1].setPWMFreq(1600);
       println("setting pumps off");
@@ -32,32 +127,83 @@ class PWMDriver : public KPComponent {
       println("done");
     }
 
+    // Stop the oscillators of both drivers; outputs are off while asleep
+    void sleep(){
+      I2CBus::Lock lock;
+      drives[0].sleep();
+      drives[1].sleep();
+    }
+
+    // Restart the oscillators and start again from every pump off
+    void wakeup(){
+      I2CBus::Lock lock;
+      drives[0].wakeup();
+      drives[1].wakeup();
+      writeAllPumpsOff();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Neutral on every channel of each board with pumps, through the ALL_LED
+     *  registers: one I2C transaction per board
+     *  ──────────────────────────────────────────────────────────────────────────── */
     void writeAllPumpsOff(){
+      I2CBus::Lock lock;
+      const unsigned long start = micros();
+      // Always sent, whatever the shadow registers say
+      for(int d = 0; d * capacityPerDriver < pumpsCount; d++){
+        const uint16_t off  = ticks(d, PumpSettings::OFF);
+        const uint8_t data[] = {PCA9685_ALLLED_ON_L, 0, 0, uint8_t(off & 0xFF), uint8_t(off >> 8)};
+        const bool sent     = transmit(d, data, sizeof(data));
+        std::fill_n(shadow + d * capacityPerDriver, capacityPerDriver, sent ? off : UNKNOWN);
+      }
+
+      shutdownLatency    = micros() - start;
+      maxShutdownLatency = max(maxShutdownLatency, shutdownLatency);
       for(int i = 0; i < pumpsCount; i++){
-        drives[i / capacityPerDriver].writeMicroseconds(i % capacityPerDriver, 1500);
         pumps[i] = PumpStatus::off;
       }
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  writeAllPumpsOff for interrupt handlers (overpressure): the pulse widths the
+     *  main loop writes afterwards are dropped until it calls releaseCutoff, so no pump
+     *  restarts before the loop has caught up with the cutoff
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void cutoff(){
+      I2CBus::Lock lock;
+      cut = true;
+      writeAllPumpsOff();
+    }
+
+    void releaseCutoff(){
+      cut = false;
+    }
+
+    //Temporarily reducing forwards and backwords strength
+    //https://bluerobotics.com/wp-content/uploads/2022/04/thruster-usage-guide-PWM-signal.png 
+    static int pulseWidth(PumpStatus signal){
+      if(signal == PumpStatus::off)
+        return PumpSettings::OFF;
+      else if (signal == PumpStatus::forwards)
+        return PumpSettings::FORWARDS;
+      else
+        return PumpSettings::BACKWARDS;
+    }
+
     void writePump(int pump, PumpStatus signal){
       if(pump < 0 || pump >= pumpsCount)
         return;
-      //Temporarily reducing forwards and backwords strength
-      //https://bluerobotics.com/wp-content/uploads/2022/04/thruster-usage-guide-PWM-signal.png 
-      pumps[pump] = signal;
-      if(pumps[pump] == PumpStatus::off)
-        drives[pump / capacityPerDriver].writeMicroseconds(pump % capacityPerDriver, 1500);
-      else if (pumps[pump] == PumpStatus::forwards)
-        drives[pump / capacityPerDriver].writeMicroseconds(pump % capacityPerDriver, 1800);
-      else
-        drives[pump / capacityPerDriver].writeMicroseconds(pump % capacityPerDriver, 1400);
+      writePumpVariable(pump, pulseWidth(signal));
     }
 
 
     void writePumpVariable(int pump, int speed){
       if(pump < 0 || pump >= pumpsCount)
         return;
-      if((speed > 1900) || (speed < 1100))
+      if((speed > PumpSettings::MAX_PULSE) || (speed < PumpSettings::MIN_PULSE))
+        return;
+      I2CBus::Lock lock;
+      if(cut)
         return;
       if(speed > 1500)
         pumps[pump] = PumpStatus::forwards;
@@ -65,7 +211,78 @@ class PWMDriver : public KPComponent {
         pumps[pump] = PumpStatus::backwards;
       else
         pumps[pump] = PumpStatus::off;
-      drives[pump / capacityPerDriver].writeMicroseconds(pump % capacityPerDriver, speed);
+      const int driver   = pump / capacityPerDriver;
+      const uint16_t off = ticks(driver, speed);
+      if(shadow[pump] == off){
+        metrics.skipped++;
+        return;
+      }
+
+      writeChannels(driver, pump % capacityPerDriver, 1, off);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Write the same pulse width to several pumps, one burst per run of consecutive
+     *  channels on the same board
+     *
+     *  @param pins Pumps, in any order
+     *  @param speed Pulse width in µs (PumpSettings::MIN_PULSE - MAX_PULSE)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writePumpsVariable(const std::vector<int> & pins, int speed){
+      writePumpsVariable(maskOf(pins), speed);
+    }
+
+    // Bit i set for each valid pump i of the list
+    uint32_t maskOf(const std::vector<int> & pins) const {
+      uint32_t mask = 0;
+      for(auto pump : pins){
+        if(pump >= 0 && pump < pumpsCount)
+          mask |= 1ul << pump;
+      }
+
+      return mask;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  writePumpsVariable for the pumps of a bit mask. Does not allocate, so the
+     *  actuation interrupt can call it.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void writePumpsVariable(uint32_t mask, int speed){
+      if((speed > PumpSettings::MAX_PULSE) || (speed < PumpSettings::MIN_PULSE))
+        return;
+      I2CBus::Lock lock;
+      if(cut)
+        return;
+      const int8_t status = speed > 1500 ? PumpStatus::forwards
+                          : speed < 1500 ? PumpStatus::backwards
+                          : PumpStatus::off;
+
+      // Only the channels whose registers change
+      for(int pump = 0; pump < pumpsCount; pump++){
+        if(!(mask & (1ul << pump)))
+          continue;
+        pumps[pump] = status;
+        if(shadow[pump] == ticks(pump / capacityPerDriver, speed)){
+          mask &= ~(1ul << pump);
+          metrics.skipped++;
+        }
+      }
+
+      for(int pump = 0; pump < pumpsCount;){
+        if(!(mask & (1ul << pump))){
+          pump++;
+          continue;
+        }
+
+        const int driver = pump / capacityPerDriver;
+        int end          = pump + 1;
+        while(end < pumpsCount && (mask & (1ul << end)) && end / capacityPerDriver == driver){
+          end++;
+        }
+
+        writeChannels(driver, pump % capacityPerDriver, end - pump, ticks(driver, speed));
+        pump = end;
+      }
     }
 
-};
\ No newline at end of file
+};
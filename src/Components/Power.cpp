@@ -1,13 +1,21 @@
 #include "Components/Power.hpp"
+#include "Components/DeadlineScheduler.hpp"
 
 volatile unsigned long rtcInterruptStart = 0;
 volatile bool alarmTriggered             = false;
 
+// Edges closer than this (ms) to the previous one are bounces
+static constexpr unsigned long RTC_DEBOUNCE = 1000;
+
 void rtc_isr() {
-    if ((unsigned long) (millis() - rtcInterruptStart) < 1000) {
+    if ((unsigned long) (millis() - rtcInterruptStart) < RTC_DEBOUNCE) {
         return;
     }
 
     alarmTriggered    = true;
     rtcInterruptStart = millis();
-}
\ No newline at end of file
+    DeadlineScheduler::interrupt();
+}
+void rtc_isr_rearm() {
+    rtcInterruptStart = millis() - RTC_DEBOUNCE;
+}
@@ -4,21 +4,37 @@
 #include <KPFoundation.hpp>
 #include "RTClib.h"
 #include <TimeLib.h>
-//#include <LowPower.h>
+#include <ArduinoLowPower.h>
 #include <Wire.h>
 #include <SPI.h>
 #include <functional>
 
 #include <Application/Constants.hpp>
+#include <Components/ClockDrift.hpp>
+#include <Components/I2CBus.hpp>
 
 extern volatile unsigned long rtcInterruptStart;
 extern volatile bool alarmTriggered;
 extern void rtc_isr();
+// Accept the next RTC edge whenever it comes (see sleepForever)
+extern void rtc_isr_rearm();
 
 class Power : public KPComponent {
+  private:
+    // Last sync point between the RTC and millis(): millis() at the start of syncEpoch
+    time_t syncEpoch         = 0;
+    unsigned long syncMillis = 0;
+    // Whether syncMillis is the start of syncEpoch (RTC interrupt) or within it
+    bool syncAligned = false;
+    // Set once the last stage of the alarm cascade fired, until the callback runs
+    bool alarmDue = false;
+
   public:
     RTC_PCF8523 rtc;
+    ClockDrift drift;
     std::function<void()> interruptCallback;
+    // Epoch the alarm cascade is heading for, 0 if no alarm is pending
+    time_t alarmAt = 0;
     Power(const char * name) : KPComponent(name) {}
 
     void onInterrupt(std::function<void()> callbcak) {
@@ -26,6 +42,7 @@ class Power : public KPComponent {
     }
 
     void setupRTC() {
+      I2CBus::Lock lock;
       rtc.begin();
 
       if (! rtc.initialized() || rtc.lostPower()){
@@ -35,15 +52,10 @@ class Power : public KPComponent {
 
       rtc.start();
 
-      //TODO - add calibration from config vars here!
-      //drift is between -64 and +63
-      //float deviation_ppm = (drift / (7 * 86400 * 1000000));
-      //int offset = round(deviation_ppm / 4.34);
-      // rtc.calibrate(PCF8523_TwoHours, 0); // Un-comment to cancel previous calibration
-      // rtc.calibrate(PCF8523_TwoHours, offset); // Un-comment to perform calibration once drift (seconds) and observation period (seconds) are correct
+      // Calibration is applied by applyCalibration once drift.js has been loaded
 
       //Note: unable to sync provider because of the way RTC is defined in library, so we manually set resync time in App.hpp
-      setTime(rtc.now().unixtime());
+      setSystemTime(rtc.now().unixtime());
 
       pinMode(HardwarePins::RTC_INTERRUPT, INPUT);        // set up interrupt pin
       digitalWrite(HardwarePins::RTC_INTERRUPT, HIGH);    // turn on pullup resistors
@@ -67,6 +79,7 @@ class Power : public KPComponent {
     }
 
     void printCurrentTime(int offset = 0) {
+        I2CBus::Lock lock;
         printTime(rtc.now().unixtime(), offset);
     }
 
@@ -75,29 +88,130 @@ class Power : public KPComponent {
     }
 
     void update() override {
-      //check for alarm trigger
-        if (!alarmTriggered || !interruptCallback) {
+        if (!advanceAlarm() || !interruptCallback) {
             return;
         }
 
-      //note: this assumes interrupt was read from rtc and not noise
-      rtc.deconfigureAllTimers();
-      noInterrupts();
-      interruptCallback();
-      alarmTriggered = false;
+        alarmDue = false;
+        noInterrupts();
+        interruptCallback();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Set the Time library and remember the sync point used by millisUntil
+     *
+     *  @param epoch Current time
+     *  @param atMillis millis() at the start of that second (default: now)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void setSystemTime(time_t epoch, unsigned long atMillis = millis()) {
+        setTime(epoch);
+        syncEpoch   = epoch;
+        syncMillis  = atMillis;
+        syncAligned = false;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Sync on an RTC interrupt, which marks the start of a second, and feed the
+     *  millis() drift estimate
+     *
+     *  @param epoch RTC time
+     *  @param atMillis millis() when the interrupt fired
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void secondDidStart(time_t epoch, unsigned long atMillis) {
+        setSystemTime(epoch, atMillis);
+        syncAligned = true;
+        drift.secondDidStart(epoch, atMillis);
+    }
+
+    // Write the offset of the drift model to the PCF8523 offset register
+    void applyCalibration() {
+        println("RTC offset: ", drift.rtcOffset);
+        I2CBus::Lock lock;
+        rtc.calibrate(PCF8523_TwoHours, drift.rtcOffset);
+    }
+
+    // Feed the RTC drift estimate right before the RTC is set to UTC
+    void utcDidSync(time_t utc) {
+        I2CBus::Lock lock;
+        if (drift.utcDidSync(utc, rtc.now().unixtime())) {
+            applyCalibration();
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Milliseconds until the given epoch according to the last sync point, negative
+     *  when it is past. Sub-second accurate after an RTC countdown interrupt, which
+     *  fires on a second boundary.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long millisUntil(time_t epoch) const {
+        return long(syncMillis + drift.scale(secsToMillis(epoch - syncEpoch)) - millis());
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Resync the Time library from the RTC. An aligned sync point is kept: with the
+     *  drift corrected it stays more precise than a read with 1 s resolution.
+     *
+     *  @return Milliseconds until the next resync
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    unsigned long resync() {
+        I2CBus::Lock lock;
+        const time_t epoch = rtc.now().unixtime();
+        if (syncAligned) {
+            setTime(epoch);
+        } else {
+            setSystemTime(epoch);
+        }
+
+        return drift.resyncInterval();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Handle a pending RTC interrupt: sync on it, then arm the next stage of the
+     *  cascade if alarmAt is still ahead.
+     *
+     *  @return true if the alarm is due
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool advanceAlarm() {
+        if (!alarmTriggered) {
+            return alarmDue;
+        }
+
+        //note: this assumes interrupt was read from rtc and not noise
+        I2CBus::Lock lock;
+        alarmTriggered = false;
+        rtc.deconfigureAllTimers();
+        secondDidStart(rtc.now().unixtime(), rtcInterruptStart);
+
+        const long remaining = long(alarmAt - now());
+        if (alarmAt && remaining > 0) {
+            setTimeout(remaining, true);
+            return false;
+        }
+
+        alarmAt  = 0;
+        alarmDue = true;
+        return true;
     }
 
-    //CHECK FOR RELEVANCE/ACCURACY
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Put the chip in standby until the RTC interrupt fires. millis() does not advance
+     *  in standby, so the Time library is resynced from the RTC on wake up.
+     *  ──────────────────────────────────────────────────────────────────────────── */
     void sleepForever() {
         println();
         println("Going to sleep...");
-        for (int i = 3; i > 0; i--) {
-            print(F("-> "));
-            println(i);
-            delay(333);
+        LowPower.attachInterruptWakeup(HardwarePins::RTC_INTERRUPT, rtc_isr, RISING);
+        // millis() stands still until the wake up edge, which would otherwise fall within
+        // the debounce window of the edge that started the previous stage of the cascade
+        rtc_isr_rearm();
+        LowPower.sleep();
+
+        drift.millisDidStop();
+        {
+            I2CBus::Lock lock;
+            setSystemTime(rtc.now().unixtime());
         }
 
-        //LowPower.standby();
         println();
         println("Just woke up due to interrupt!");
         printCurrentTime();
@@ -113,8 +227,10 @@ class Power : public KPComponent {
         println("Setting RTC Time...");
         printTime(seconds);
 
-        setTime(seconds);  // Set time in Time library
+        drift.millisDidStop();
+        setSystemTime(seconds);  // Set time in Time library
         DateTime dt(seconds);
+        I2CBus::Lock lock;
         rtc.adjust(dt);  // Set time for RTC
     }
 
@@ -129,7 +245,8 @@ class Power : public KPComponent {
     }
 
     /** ────────────────────────────────────────────────────────────────────────────
-     *  Schedule RTC alarm given utc
+     *  Schedule RTC alarm given utc. Long delays go through a cascade of countdowns
+     *  (hours, then minutes, then seconds), each re-armed by advanceAlarm.
      *
      *  @param utc Must be in the future, otherwise this method does nothing
      *  ──────────────────────────────────────────────────────────────────────────── */
@@ -140,6 +257,8 @@ class Power : public KPComponent {
         }
 
         println("Alarm triggering in: ", utc - timestamp, " seconds");
+        alarmAt  = utc;
+        alarmDue = false;
         setTimeout(utc - timestamp, true);
     }
 
@@ -149,30 +268,34 @@ class Power : public KPComponent {
      *  @param seconds How long in seconds
      *  ────────────────────────────────────────────────────────────────────────────*/
     void sleepFor(unsigned long seconds) {
-        setTimeout(seconds, true);
-        sleepForever();
+        scheduleNextAlarm(now() + seconds);
+        while (!advanceAlarm()) {
+            sleepForever();
+        }
+
+        alarmDue = false;
     }
 
     /** ────────────────────────────────────────────────────────────────────────────
-     *  Schedule alarm for specified number of seconds from now
+     *  Arm one stage of the alarm: the coarsest countdown that cannot overshoot. A
+     *  countdown of n periods fires after (n - 1, n] periods, on a second boundary.
      *
      *  @param seconds How long until alarm
      *  @param usingInterrupt If true, the rtc fires interrupt at HardwarePins::RTC_INTERRUPT
      *  ────────────────────────────────────────────────────────────────────────────*/
     void setTimeout(unsigned long seconds, bool usingInterrupt) {
-        TimeElements future;
-        breakTime(rtc.now().unixtime() + seconds, future);
+        I2CBus::Lock lock;
         rtc.deconfigureAllTimers();
         println("Setting alarm");
 
-        //use second frequency if less than a 255 seconds
-        if(seconds < 255)
-          rtc.enableCountdownTimer(PCF8523_FrequencySecond, min((seconds), (unsigned long) 255));
-        //Use minute frequency if time is less than 255 minustes
-        if(seconds < 15300)
-          rtc.enableCountdownTimer(PCF8523_FrequencyMinute, min((seconds / 60), (unsigned long) 255));
-        //Use hour frequency, clamp to 255 hours
-        rtc.enableCountdownTimer(PCF8523_FrequencyHour, min((seconds / 3600), (unsigned long) 255));
+        if (seconds <= 255) {
+            rtc.enableCountdownTimer(PCF8523_FrequencySecond, max(seconds, 1ul));
+        } else if (seconds < 256 * 60) {
+            rtc.enableCountdownTimer(PCF8523_FrequencyMinute, seconds / 60);
+        } else {
+            rtc.enableCountdownTimer(PCF8523_FrequencyHour, min((seconds / 3600), (unsigned long) 255));
+        }
+
         if (usingInterrupt) {
             println("Attaching Interrupt");
             attachInterrupt(digitalPinToInterrupt(HardwarePins::RTC_INTERRUPT), rtc_isr, RISING);
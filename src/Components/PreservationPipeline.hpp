@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <KPFoundation.hpp>
+#include <Components/PumpArbiter.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Task/Phase.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: P R E S E R V A T I O N   P I P E L I N E : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────────────────
+//
+// Runs the tail of a valve cycle (PreserveFlush then Preserve) in the background so that a
+// pipelined task can start sampling its next valve right away. Each valve goes through the
+// same phases, with the same durations and pump values, as SharedStates::PreserveFlush and
+// SharedStates::Preserve; only the next valve's sampling overlaps with them.
+//
+class PreservationPipeline : public KPComponent {
+private:
+    enum Phase { flushing, preserving };
+
+    struct Entry {
+        int pin;
+        Phase phase;
+        unsigned long phaseStart;
+        unsigned long phaseLength;
+        unsigned long preserveLength;
+    };
+
+    PumpArbiter & pumps;
+    std::vector<Entry> entries;
+
+public:
+    PreservationPipeline(const char * name, PumpArbiter & pumps) : KPComponent(name), pumps(pumps) {}
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start preserving a valve that just finished sampling
+     *
+     *  @param pin Pump of the valve
+     *  @param preserveDrawTime Seconds spent reversing the pump (PreserveFlush)
+     *  @param preserveTime Seconds spent preserving (Preserve)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void preserve(int pin, int preserveDrawTime, int preserveTime) {
+        // Same padding as the foreground PreserveFlush and Preserve states
+        entries.push_back({pin, flushing, millis(),
+                           secsToMillis(preserveDrawTime + ::Phase::padding(::Phase::preserveFlush)),
+                           secsToMillis(preserveTime + ::Phase::padding(::Phase::preserve))});
+        DeadlineScheduler::sharedInstance().wakeIn(entries.back().phaseLength);
+        pumps.write(pin, PumpStatus::backwards);
+    }
+
+    bool isBusy() const {
+        return !entries.empty();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Abort every valve still being preserved and turn its pump off
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void stop() {
+        for (const auto & entry : entries) {
+            pumps.write(entry.pin, PumpStatus::off);
+        }
+
+        entries.clear();
+    }
+
+    void update() override {
+        const unsigned long time = millis();
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (time - it->phaseStart < it->phaseLength) {
+                it++;
+                continue;
+            }
+
+            if (it->phase == flushing) {
+                it->phase       = preserving;
+                it->phaseStart  = time;
+                it->phaseLength = it->preserveLength;
+                DeadlineScheduler::sharedInstance().wakeIn(it->phaseLength);
+                pumps.writeVariable(it->pin, PumpSettings::PRESERVE);
+                it++;
+            } else {
+                pumps.write(it->pin, PumpStatus::off);
+                println("Valve preserved: ", it->pin);
+                it = entries.erase(it);
+            }
+        }
+    }
+};
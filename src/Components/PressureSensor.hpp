@@ -3,8 +3,10 @@
 #include <KPSubject.hpp>
 #include <Components/PressureSensorObserver.hpp>
 #include <Wire.h>
+#include <Components/I2CBus.hpp>
 #include "KellerLD.h"
 #include <KPFoundation.hpp>
+#include <Components/DeadlineScheduler.hpp>
 
 class PressureSensor : public KPComponent, public KPSubject<PressureSensorObserver> {
 
@@ -13,18 +15,105 @@ class PressureSensor : public KPComponent, public KPSubject<PressureSensorObserv
     KellerLD sensor;
     unsigned long updateTime;
     bool initialized;
+    bool parked = false;
+    unsigned long interval = PressureSettings::INTERVAL;
+    // Readings are printed at most once per PressureSettings::INTERVAL
+    unsigned long printTime = 0;
+    // Intervals (ms) asked for by other components; the fastest one applies
+    std::vector<unsigned long> requests;
+
+    // Read at least every ms milliseconds until releaseInterval(ms)
+    void requestInterval(unsigned long ms) {
+      requests.push_back(ms);
+      applyInterval();
+    }
+
+    void releaseInterval(unsigned long ms) {
+      auto request = std::find(requests.begin(), requests.end(), ms);
+      if (request != requests.end()) {
+        requests.erase(request);
+      }
+
+      applyInterval();
+    }
+
+    void applyInterval() {
+      unsigned long fastest = PressureSettings::INTERVAL;
+      for (auto ms : requests) {
+        fastest = min(fastest, ms);
+      }
+
+      // Next reading right away when speeding up
+      if (fastest < interval) {
+        updateTime = millis();
+        DeadlineScheduler::sharedInstance().wakeAt(updateTime);
+      }
+
+      interval = fastest;
+    }
+
+    // Stop reading the sensor (standby)
+    void park() {
+      parked = true;
+    }
+
+    // Resume reading, first reading right away
+    void restore() {
+      parked     = false;
+      updateTime = millis();
+      DeadlineScheduler::sharedInstance().wakeAt(updateTime);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief First half of a reading for interrupt handlers, which cannot wait for the
+     *  conversion like sensor.read() does: start one. The caller holds the bus.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void startConversion() {
+      Wire.beginTransmission(PressureSettings::ADDRESS);
+      Wire.write(PressureSettings::REQUEST);
+      Wire.endTransmission();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Second half: read the conversion back, at least
+     *  PressureSettings::CONVERSION_TIME after starting it. The caller holds the bus.
+     *
+     *  @param pressure Set to the pressure in mbar, scaled like sensor.pressure()
+     *  @return false if the sensor did not answer
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool readConversion(float & pressure) {
+      if (Wire.requestFrom(uint8_t(PressureSettings::ADDRESS), size_t(5)) != 5) {
+        return false;
+      }
+
+      Wire.read();  // Status
+      uint16_t counts = Wire.read() << 8;
+      counts |= Wire.read();
+      Wire.read();  // Temperature
+      Wire.read();
+
+      const float bar = (float(counts) - 16384) * (sensor.P_max - sensor.P_min) / 32768
+                      + sensor.P_min + sensor.P_mode;
+      pressure = bar * 1000;
+      return true;
+    }
 
     void setup() override {
-      updateTime = millis() + 1000;
+      updateTime = millis() + interval;
+      DeadlineScheduler::sharedInstance().wakeAt(updateTime);
+
+      {
+        I2CBus::Lock lock;
+        Wire.begin();
 
-      Wire.begin();
+        // Initialize pressure sensor
+        sensor.init();
 
-      // Initialize pressure sensor
-      sensor.init();
+        sensor.setFluidDensity(1029); // kg/m^3 (1029 for seawater)
 
-      sensor.setFluidDensity(1029); // kg/m^3 (1029 for seawater)
+        initialized = sensor.isInitialized();
+      }
 
-      initialized = sensor.isInitialized();
       if(initialized) {
         println("Sensor connected.");
       } else {
@@ -34,16 +123,26 @@ class PressureSensor : public KPComponent, public KPSubject<PressureSensorObserv
     }
 
   void update() override {
-    if ((!initialized) || (millis() < updateTime)){
+    if ((!initialized) || parked || long(millis() - updateTime) < 0){
       return;
     }
-    updateTime = millis() + 1000;
-    // Update pressure and temperature readings
-    sensor.read();
+    updateTime = millis() + interval;
+    DeadlineScheduler::sharedInstance().wakeAt(updateTime);
+    // Update pressure and temperature readings. Timed pump commands due meanwhile go
+    // out right after.
+    {
+      I2CBus::Lock lock;
+      sensor.read();
+    }
 
     //PressureSensorData data = {sensor.pressure(), sensor.temperature()};
     updateObservers(&PressureSensorObserver::pressureSensorDidUpdate, sensor.pressure(), sensor.temperature());
 
+    if (long(millis() - printTime) < 0) {
+      return;
+    }
+    printTime = millis() + PressureSettings::INTERVAL;
+
     print("Pressure: ");
     print(sensor.pressure());
     println(" mbar");
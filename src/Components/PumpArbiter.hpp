@@ -0,0 +1,347 @@
+#pragma once
+#include <functional>
+#include <numeric>
+#include <vector>
+#include <KPFoundation.hpp>
+#include <Components/PWMDriver.hpp>
+#include <Components/Actuator.hpp>
+#include <Components/RampEngine.hpp>
+#include <Application/Config.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────── I ──────────
+//   :::::: P U M P   A R B I T E R : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────
+//
+// Every pump command goes through here. The arbiter remembers the pulse width of each
+// channel, estimates the current it draws and only grants a command if the total stays
+// within config.pumpCurrentBudget. Commands that lower the draw (stopping or slowing a
+// pump) are always granted; the others wait in a FIFO queue until enough current is
+// released. A budget of 0 disables the limit.
+//
+// Commands that do not raise the draw can also be scheduled for a given millisecond; the
+// actuator sends them from its timer interrupt and update() catches up with them.
+//
+// Granted commands ramp to their pulse width (RampEngine); the budget is checked against
+// the target. Timed commands ramp so they reach their pulse width at the given time, and
+// the actuator sends the final width on time. Only allOff, for panics and overpressure,
+// jumps.
+//
+class PumpArbiter : public KPComponent {
+private:
+    struct Request {
+        int pin;
+        int micros;
+    };
+
+    PWMDriver & pwm;
+    Actuator & actuator;
+    RampEngine ramp;
+    std::vector<int> micros;
+    std::vector<Request> queue;
+    std::function<void()> startCallback;
+
+public:
+    long budget              = 0;
+    long fullThrottleCurrent = PumpSettings::FULL_THROTTLE_CURRENT;
+
+    PumpArbiter(const char * name, PWMDriver & pwm, Actuator & actuator)
+        : KPComponent(name), pwm(pwm), actuator(actuator), ramp(pwm), micros(pwm.pumpsCount, PumpSettings::OFF) {}
+
+    void init(Config & config) {
+        budget              = config.pumpCurrentBudget;
+        fullThrottleCurrent = config.pumpFullThrottleCurrent;
+        ramp.shape          = config.rampShape;
+        for (int pin = 0; pin < min(pwm.pumpsCount, int(PumpSettings::CHANNELS)); pin++) {
+            ramp.setRampTime(pin, config.rampTimes[pin]);
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Estimated draw of one pump. Thruster current grows roughly with the square
+     *  of the throttle outside of the ESC deadband.
+     *
+     *  @param pulse Pulse width in µs
+     *  @return long Current in mA
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long estimateCurrent(int pulse) const {
+        using namespace PumpSettings;
+        const int deviation = abs(pulse - OFF) - DEADBAND;
+        if (deviation <= 0) {
+            return 0;
+        }
+
+        const float throttle = min(deviation / float(FULL_THROTTLE - DEADBAND), 1.0f);
+        return lround(fullThrottleCurrent * throttle * throttle);
+    }
+
+    long totalCurrent() const {
+        long total = 0;
+        for (auto pulse : micros) {
+            total += estimateCurrent(pulse);
+        }
+
+        return total;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Number of additional pumps that can run at the given pulse width on top
+     *  of the current load
+     *
+     *  @param pulse Pulse width in µs
+     *  @param limit Value returned when the budget is disabled or the pump draws nothing
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    int capacityFor(int pulse, int limit) const {
+        const long each = estimateCurrent(pulse);
+        if (budget <= 0 || each == 0) {
+            return limit;
+        }
+
+        return min<long>(max<long>(budget - totalCurrent(), 0) / each, limit);
+    }
+
+    // Pulse width a pump is at right now, which lags the granted one while ramping
+    int outputOf(int pin) const {
+        return ramp.output(pin);
+    }
+
+    bool isRamping() const {
+        return ramp.isRamping();
+    }
+
+    // Called whenever a pump is granted a pulse width other than neutral, before it is
+    // written (e.g. to arm the overpressure guard)
+    void onStart(std::function<void()> callback) {
+        startCallback = callback;
+    }
+
+    // Whether any pump is granted or still at a pulse width other than neutral
+    bool isPumping() const {
+        for (int pin = 0; pin < pwm.pumpsCount; pin++) {
+            if (micros[pin] != PumpSettings::OFF || ramp.output(pin) != PumpSettings::OFF) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    size_t numberOfQueuedRequests() const {
+        return queue.size();
+    }
+
+    bool write(int pin, PumpStatus signal) {
+        return writeVariable(pin, PWMDriver::pulseWidth(signal));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Request a pulse width for a pump. Replaces any queued request for the
+     *  same pump.
+     *
+     *  @param pin Pump channel
+     *  @param pulse Pulse width in µs (PumpSettings::MIN_PULSE - MAX_PULSE)
+     *  @return true if the command was sent, false if it was queued or rejected
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool writeVariable(int pin, int pulse) {
+        if (pin < 0 || pin >= pwm.pumpsCount || pulse > PumpSettings::MAX_PULSE || pulse < PumpSettings::MIN_PULSE) {
+            return false;
+        }
+
+        dequeue(pin);
+        actuator.cancel({pin});
+        if (!fits(pin, pulse)) {
+            println(BROWN("Pump "), pin, " queued, over budget by ",
+                    totalCurrent() - estimateCurrent(micros[pin]) + estimateCurrent(pulse) - budget,
+                    " mA");
+            queue.push_back({pin, pulse});
+            return false;
+        }
+
+        const bool releases = estimateCurrent(pulse) < estimateCurrent(micros[pin]);
+        apply(pin, pulse);
+        if (releases) {
+            grantQueuedRequests();
+        }
+
+        return true;
+    }
+
+    bool writeAll(const std::vector<int> & pins, PumpStatus signal) {
+        return writeAllVariable(pins, PWMDriver::pulseWidth(signal));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief writeVariable for several pumps at once. The granted commands go out
+     *  in as few I2C transactions as the channel layout allows.
+     *
+     *  @param ramped false for closed-loop corrections: no ramp, and timed commands
+     *  (the stop at the end of the phase) stay scheduled
+     *  @return true if every command was sent
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool writeAllVariable(const std::vector<int> & pins, int pulse, bool ramped = true) {
+        std::vector<int> granted;
+        granted.reserve(pins.size());
+        bool releases = false;
+        if (ramped) {
+            actuator.cancel(pins);
+        }
+
+        for (auto pin : pins) {
+            if (pin < 0 || pin >= pwm.pumpsCount || pulse > PumpSettings::MAX_PULSE || pulse < PumpSettings::MIN_PULSE) {
+                continue;
+            }
+
+            dequeue(pin);
+            if (!fits(pin, pulse)) {
+                println(BROWN("Pump "), pin, " queued");
+                queue.push_back({pin, pulse});
+                continue;
+            }
+
+            releases |= estimateCurrent(pulse) < estimateCurrent(micros[pin]);
+            micros[pin] = pulse;
+            granted.push_back(pin);
+        }
+
+        if (!granted.empty()) {
+            didGrant(pulse);
+        }
+
+        if (ramped) {
+            ramp.start(granted, pulse);
+        } else {
+            ramp.jump(granted, pulse);
+        }
+
+        if (releases) {
+            grantQueuedRequests();
+        }
+
+        return granted.size() == pins.size();
+    }
+
+    bool scheduleAll(const std::vector<int> & pins, PumpStatus signal, unsigned long due) {
+        return scheduleAllVariable(pins, PWMDriver::pulseWidth(signal), due);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Have the actuator send a pulse width to several pumps at the given time,
+     *  regardless of what the main loop is doing by then. Only for commands that do not
+     *  raise the draw of any of the pumps (stops, direction changes, slowing down):
+     *  their grant cannot depend on what happens until then.
+     *
+     *  @param due millis() at which to send the command
+     *  @return false if the command raises the draw or the actuator queue is full; the
+     *  caller then sends it itself
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool scheduleAllVariable(const std::vector<int> & pins, int pulse, unsigned long due) {
+        if (pulse > PumpSettings::MAX_PULSE || pulse < PumpSettings::MIN_PULSE) {
+            return false;
+        }
+
+        for (auto pin : pins) {
+            if (pin >= 0 && pin < pwm.pumpsCount && estimateCurrent(pulse) > estimateCurrent(micros[pin])) {
+                return false;
+            }
+        }
+
+        if (!actuator.schedule(due, pins, pulse)) {
+            return false;
+        }
+
+        ramp.schedule(pins, pulse, due);
+        return true;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Drop every queued request and timed command, and ramp all pumps down
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void stopAll() {
+        std::vector<int> pins(pwm.pumpsCount);
+        std::iota(pins.begin(), pins.end(), 0);
+        queue.clear();
+        writeAllVariable(pins, PumpSettings::OFF);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Drop every queued request and turn all pumps off right away. Only for
+     *  panics and overpressure: normal stops use stopAll.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void allOff() {
+        actuator.cancelAll();
+        queue.clear();
+        pwm.writeAllPumpsOff();
+        pwm.releaseCutoff();
+        ramp.didWrite(~0ul, PumpSettings::OFF);
+        std::fill(micros.begin(), micros.end(), PumpSettings::OFF);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief allOff from an interrupt handler (the overpressure guard). The pumps are
+     *  off when it returns; their writes are dropped until the main loop calls allOff,
+     *  which also brings the bookkeeping up to date.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void cutoff() {
+        actuator.cancelAll();
+        pwm.cutoff();
+    }
+
+    void update() override {
+        {
+            // Holding the bus, a timed command cannot land between collecting and the
+            // ramp step and then be overwritten by it
+            I2CBus::Lock lock;
+            actuator.service();
+
+            // Commands the actuator sent since the last update
+            actuator.collect([this](const ActuationRecord & record) {
+                ramp.didWrite(record.pins, record.pulse);
+                for (int pin = 0; pin < pwm.pumpsCount; pin++) {
+                    if (record.pins & (1ul << pin)) {
+                        dequeue(pin);
+                        micros[pin] = record.pulse;
+                    }
+                }
+            });
+
+            ramp.step();
+        }
+
+        grantQueuedRequests();
+    }
+
+private:
+    bool fits(int pin, int pulse) const {
+        const long after = estimateCurrent(pulse);
+        const long before = estimateCurrent(micros[pin]);
+        return budget <= 0 || after <= before || totalCurrent() - before + after <= budget;
+    }
+
+    void apply(int pin, int pulse) {
+        micros[pin] = pulse;
+        didGrant(pulse);
+        ramp.start({pin}, pulse);
+    }
+
+    void didGrant(int pulse) {
+        if (pulse != PumpSettings::OFF && startCallback) {
+            startCallback();
+        }
+    }
+
+    void dequeue(int pin) {
+        queue.erase(std::remove_if(queue.begin(), queue.end(),
+                                   [pin](const Request & r) { return r.pin == pin; }),
+                    queue.end());
+    }
+
+    // First come, first served: a request never overtakes an earlier one
+    void grantQueuedRequests() {
+        while (!queue.empty() && fits(queue.front().pin, queue.front().micros)) {
+            const Request request = queue.front();
+            queue.erase(queue.begin());
+            apply(request.pin, request.micros);
+            println(GREEN("Pump "), request.pin, " granted");
+        }
+    }
+};
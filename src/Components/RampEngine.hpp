@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+
+#include <KPFoundation.hpp>
+
+#include <Application/Constants.hpp>
+#include <Components/DeadlineScheduler.hpp>
+#include <Components/I2CBus.hpp>
+#include <Components/PWMDriver.hpp>
+#include <Components/RampProfile.hpp>
+
+//
+// ──────────────────────────────────────────────────────────── I ──────────
+//   :::::: R A M P   E N G I N E : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────
+//
+// Moves pump channels from their current pulse width to a target one along a ramp
+// profile instead of in one jump. Each channel has its own ramp time (0 for a jump).
+// step() is non-blocking: it writes the pulse width every ramping channel should have
+// by now, one I2C burst per group of channels at the same width, and asks the main loop
+// to come back in RampSettings::STEP_INTERVAL ms while anything is still ramping.
+//
+// A ramp can also be scheduled to end at a given time (the timed stop of a phase): it
+// starts one ramp time ahead, and writes without a ramp (closed-loop corrections) only
+// move its starting point until then.
+//
+class RampEngine {
+private:
+    struct Channel {
+        int16_t output    = PumpSettings::OFF;  // Last pulse width written
+        int16_t from      = PumpSettings::OFF;
+        int16_t target    = PumpSettings::OFF;
+        uint16_t duration = 0;  // Configured ramp time (ms)
+        uint16_t span     = 0;  // Length of the current ramp (ms)
+        unsigned long start = 0;
+    };
+
+    PWMDriver & pwm;
+    std::vector<Channel> channels;
+    uint32_t ramping   = 0;  // Bit mask of the channels still ramping
+    uint32_t scheduled = 0;  // Channels of ramping whose ramp was scheduled ahead
+
+    static bool isBefore(unsigned long a, unsigned long b) {
+        return long(a - b) < 0;
+    }
+
+public:
+    RampShape shape = RampShape::scurve;
+
+    explicit RampEngine(PWMDriver & pwm) : pwm(pwm), channels(pwm.pumpsCount) {}
+
+    void setRampTime(int channel, uint16_t ms) {
+        if (channel >= 0 && channel < int(channels.size())) {
+            channels[channel].duration = ms;
+        }
+    }
+
+    // Pulse width the channel is at
+    int output(int channel) const {
+        return channel >= 0 && channel < int(channels.size()) ? channels[channel].output
+                                                              : PumpSettings::OFF;
+    }
+
+    // Whether a ramp is under way; scheduled ramps count once they have started
+    bool isRamping() const {
+        const unsigned long now = millis();
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            if ((ramping & (1ul << pin)) && !isBefore(now, channels[pin].start)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Start ramping the given pumps to a pulse width. Channels without a ramp
+     *  time jump right away.
+     *
+     *  @param pins Pump channels
+     *  @param pulse Target pulse width in µs
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void start(const std::vector<int> & pins, int pulse) {
+        const unsigned long now = millis();
+        const uint32_t mask     = pwm.maskOf(pins);
+        uint32_t jumps          = 0;
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            if (!(mask & (1ul << pin))) {
+                continue;
+            }
+
+            Channel & channel = channels[pin];
+            const uint32_t bit = 1ul << pin;
+            if ((ramping & bit) && !(scheduled & bit) && channel.target == pulse) {
+                continue;  // Already on its way there
+            }
+
+            scheduled &= ~bit;
+            channel.from   = channel.output;
+            channel.target = pulse;
+            channel.start  = now;
+            channel.span   = channel.duration;
+            if (channel.duration == 0 || channel.output == pulse) {
+                jumps |= 1ul << pin;
+                ramping &= ~(1ul << pin);
+            } else {
+                ramping |= 1ul << pin;
+            }
+        }
+
+        if (jumps) {
+            write(jumps, pulse);
+        }
+
+        step();
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Ramp the given pumps so they reach a pulse width at the given time.
+     *  Channels without a ramp time are left to whoever sends the command at that time.
+     *
+     *  @param pins Pump channels
+     *  @param pulse Target pulse width in µs
+     *  @param end millis() at which the ramp ends
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void schedule(const std::vector<int> & pins, int pulse, unsigned long end) {
+        const unsigned long now = millis();
+        const uint32_t mask     = pwm.maskOf(pins);
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            Channel & channel = channels[pin];
+            if (!(mask & (1ul << pin)) || channel.duration == 0) {
+                continue;
+            }
+
+            const unsigned long start = end - channel.duration;
+            channel.start  = isBefore(start, now) ? now : start;
+            channel.span   = isBefore(now, end) ? end - channel.start : 0;
+            channel.from   = channel.output;
+            channel.target = pulse;
+            ramping |= 1ul << pin;
+            scheduled |= 1ul << pin;
+            DeadlineScheduler::sharedInstance().wakeAt(channel.start);
+        }
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Write a pulse width to the given pumps right away, dropping their ramps.
+     *  A scheduled ramp is kept: before it starts, the pulse width becomes its starting
+     *  point; once it has started, the write is ignored.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void jump(const std::vector<int> & pins, int pulse) {
+        const unsigned long now = millis();
+        uint32_t mask           = pwm.maskOf(pins);
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            const uint32_t bit = 1ul << pin;
+            if (!(mask & bit)) {
+                continue;
+            }
+
+            Channel & channel = channels[pin];
+            if (!(scheduled & bit)) {
+                channel.target = pulse;
+                ramping &= ~bit;
+            } else if (isBefore(now, channel.start)) {
+                channel.from = pulse;
+            } else {
+                mask &= ~bit;
+            }
+        }
+
+        write(mask, pulse);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief The given pumps were written to directly (all-off, timed commands):
+     *  stop their ramps there
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void didWrite(uint32_t mask, int pulse) {
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            if (mask & (1ul << pin)) {
+                channels[pin].output = channels[pin].target = pulse;
+            }
+        }
+
+        ramping &= ~mask;
+        scheduled &= ~mask;
+    }
+
+    void step() {
+        if (!ramping) {
+            return;
+        }
+
+        I2CBus::Lock lock;
+        const unsigned long now = millis();
+        const auto & table      = rampTable(shape);
+
+        // Pulse width due on each ramping channel, then one write per distinct width.
+        // Scheduled ramps that have not started wait for the deadline set by schedule().
+        uint32_t pending = ramping;
+        int16_t due[32];
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            const uint32_t bit = 1ul << pin;
+            if (!(pending & bit)) {
+                continue;
+            }
+
+            const Channel & channel = channels[pin];
+            if (isBefore(now, channel.start)) {
+                pending &= ~bit;
+                continue;
+            }
+
+            const uint32_t progress = table.progress(now - channel.start, channel.span);
+            due[pin] = channel.from + (channel.target - channel.from) * int32_t(progress) / int32_t(RampSettings::SCALE);
+            if (due[pin] == channel.target) {
+                ramping &= ~bit;
+                scheduled &= ~bit;
+            }
+        }
+
+        while (pending) {
+            const int first = __builtin_ctz(pending);
+            uint32_t group  = 0;
+            for (size_t pin = first; pin < channels.size(); pin++) {
+                if ((pending & (1ul << pin)) && due[pin] == due[first]) {
+                    group |= 1ul << pin;
+                }
+            }
+
+            write(group, due[first]);
+            pending &= ~group;
+        }
+
+        if (isRamping()) {
+            DeadlineScheduler::sharedInstance().wakeIn(RampSettings::STEP_INTERVAL);
+        }
+    }
+
+private:
+    void write(uint32_t mask, int pulse) {
+        pwm.writePumpsVariable(mask, pulse);
+        for (size_t pin = 0; pin < channels.size(); pin++) {
+            if (mask & (1ul << pin)) {
+                channels[pin].output = pulse;
+            }
+        }
+    }
+};
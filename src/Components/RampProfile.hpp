@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Application/Constants.hpp>
+
+//
+// ────────────────────────────────────────────────────────────── I ──────────
+//   :::::: R A M P   P R O F I L E : :  :   :    :     :        :          :
+// ────────────────────────────────────────────────────────────────────────
+//
+// Shapes of a pump ramp as lookup tables computed at compile time: the progress of the
+// ramp (0 - RampSettings::SCALE) at RampSettings::STEPS + 1 evenly spaced points in time,
+// interpolated linearly in between. The s-curve is the smoothstep polynomial 3t² - 2t³,
+// which starts and ends with zero slope so the thrusters ease in and out.
+//
+enum class RampShape : uint8_t { linear, scurve };
+
+template <size_t N>
+struct RampTable {
+    uint16_t at[N + 1];
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Progress of the ramp (0 - SCALE) after elapsed of duration
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    constexpr uint16_t progress(uint32_t elapsed, uint32_t duration) const {
+        if (elapsed >= duration) {
+            return at[N];
+        }
+
+        const uint32_t position = uint64_t(elapsed) * N * RampSettings::SCALE / duration;
+        const uint32_t i        = position / RampSettings::SCALE;
+        const uint32_t fraction = position % RampSettings::SCALE;
+        return at[i] + (int32_t(at[i + 1]) - at[i]) * int32_t(fraction) / int32_t(RampSettings::SCALE);
+    }
+};
+
+template <size_t N>
+constexpr RampTable<N> makeRampTable(RampShape shape) {
+    constexpr uint32_t S = RampSettings::SCALE;
+    RampTable<N> table{};
+    for (size_t i = 0; i <= N; i++) {
+        const uint32_t t = i * S / N;
+        table.at[i]      = shape == RampShape::linear ? t : t * t * (3 * S - 2 * t) / (S * S);
+    }
+
+    return table;
+}
+
+constexpr auto LINEAR_RAMP = makeRampTable<RampSettings::STEPS>(RampShape::linear);
+constexpr auto SCURVE_RAMP = makeRampTable<RampSettings::STEPS>(RampShape::scurve);
+
+static_assert(SCURVE_RAMP.at[0] == 0 && SCURVE_RAMP.at[RampSettings::STEPS] == RampSettings::SCALE,
+              "A ramp must go from 0 to SCALE");
+static_assert(SCURVE_RAMP.at[RampSettings::STEPS / 2] == RampSettings::SCALE / 2,
+              "The s-curve must be symmetric");
+
+constexpr const RampTable<RampSettings::STEPS> & rampTable(RampShape shape) {
+    return shape == RampShape::linear ? LINEAR_RAMP : SCURVE_RAMP;
+}
@@ -3,23 +3,34 @@
 #include <States/Shared.hpp>
 
 namespace HyperFlush {
-    STATE(IDLE);
-    STATE(STOP);
-    STATE(OFFSHOOT_PRELOAD);
+    enum StateId : uint8_t { IDLE, OFFSHOOT_PRELOAD, STOP, NUMBER_OF_STATES };
+
+    constexpr const char * STATE_NAMES[NUMBER_OF_STATES] = {
+        "IDLE_STATE", "OFFSHOOT_PRELOAD_STATE", "STOP_STATE"};
+
+    // OFFSHOOT_PRELOAD -> STOP -> IDLE
+    constexpr StateTransition<StateId> TRANSITIONS[NUMBER_OF_STATES] = {
+        /* IDLE             */ {IDLE, IDLE},
+        /* OFFSHOOT_PRELOAD */ {STOP, STOP},
+        /* STOP             */ {IDLE, IDLE}};
+
+    static_assert(isValidTransitionTable(TRANSITIONS), "Unknown transition target");
 
     struct Config {
         decltype(SharedStates::Flush::time) flushTime;
         decltype(SharedStates::OffshootPreload::preloadTime) preloadTime;
+        decltype(SharedStates::OffshootPreload::parallelism) preloadParallelism;
     };
 
-    class Controller : public StateControllerWithConfig<Config> {
+    class Controller : public IndexedStateController<StateId, NUMBER_OF_STATES>,
+                       public StateControllerConfig<Config> {
     public:
-        Controller() : StateControllerWithConfig("hyperflush-state-machine") {}
+        Controller()
+            : IndexedStateController("hyperflush-state-machine", STATE_NAMES, TRANSITIONS) {}
 
-        //OFFSHOOT_PRELOAD -> STOP -> IDLE
         void setup() override {
-            registerState(SharedStates::OffshootPreload(), OFFSHOOT_PRELOAD, STOP);
-            registerState(SharedStates::Stop(), STOP, IDLE);
+            registerState(SharedStates::OffshootPreload(), OFFSHOOT_PRELOAD);
+            registerState(SharedStates::Stop(), STOP);
             registerState(SharedStates::Idle(), IDLE);
         }
 
@@ -27,6 +38,7 @@ namespace HyperFlush {
 
             decltype(auto) preload = getState<SharedStates::OffshootPreload>(OFFSHOOT_PRELOAD);
             preload.preloadTime    = config.preloadTime;
+            preload.parallelism    = config.preloadParallelism;
 
             println("transitioning to offshoot preload");
 
@@ -40,6 +52,10 @@ namespace HyperFlush {
         void idle() override {
             transitionTo(IDLE);
         }
+
+        bool isIdle() {
+            return isInState(IDLE);
+        }
     };
 }  // namespace HyperFlush
 
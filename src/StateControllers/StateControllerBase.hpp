@@ -3,8 +3,7 @@
 #include <KPStateMachine.hpp>
 #include <KPState.hpp>
 #include <type_traits>
-
-#define STATE(x) constexpr const char * x = #x "_STATE"
+#include <array>
 
 template <typename T>
 struct StateControllerConfig {
@@ -46,4 +45,156 @@ class StateControllerWithConfig : public StateController, public StateController
 public:
     using StateController::StateController;
     // using Configurator = StateControllerConfigurator<T>;
-};
\ No newline at end of file
+};
+
+// Where the exit codes of a state lead: 0 (normal) and -1 (panic)
+template <typename Id>
+struct StateTransition {
+    Id normal;
+    Id panic;
+};
+
+/** ────────────────────────────────────────────────────────────────────────────
+ *  @brief Compile-time check that every transition of the table leads to a known
+ *  state, or to one of the `dynamicTargets` ids past the last state that the
+ *  controller resolves itself
+ *  ──────────────────────────────────────────────────────────────────────────── */
+template <typename Id, size_t N>
+constexpr bool isValidTransitionTable(const StateTransition<Id> (&table)[N],
+                                      size_t dynamicTargets = 0) {
+    for (size_t i = 0; i < N; i++) {
+        if (size_t(table[i].normal) >= N + dynamicTargets
+            || size_t(table[i].panic) >= N + dynamicTargets) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** ────────────────────────────────────────────────────────────────────────────
+ *  Type-independent part of IndexedStateController, so observers can map the
+ *  KPState pointers they receive back to state ids of any controller.
+ *  ──────────────────────────────────────────────────────────────────────────── */
+class IndexedStateMachine : public StateController {
+protected:
+    const KPState * const * table = nullptr;
+    size_t count                  = 0;
+    // Exit code of the transition in progress (0 for transitions requested from outside)
+    int exitCode = 0;
+    // millis() when the last transition was requested
+    unsigned long transitionRequestedAt = 0;
+
+public:
+    using StateController::StateController;
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Index of the state in this machine, -1 if it belongs to another one
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    int indexOf(const KPState * state) const {
+        for (size_t i = 0; i < count; i++) {
+            if (table[i] == state) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    int lastExitCode() const {
+        return exitCode;
+    }
+
+    unsigned long lastTransitionRequestedAt() const {
+        return transitionRequestedAt;
+    }
+
+    // States indexed by id, for observers that only receive KPState pointers
+    const KPState * const * stateTable() const {
+        return table;
+    }
+
+    size_t numberOfStates() const {
+        return count;
+    }
+};
+
+/** ────────────────────────────────────────────────────────────────────────────
+ *  State controller whose states are identified by an enum. Names only exist for
+ *  KPStateMachine registration and logs; transitions follow a constexpr table indexed
+ *  by state id and the current state is resolved by pointer, without string compare.
+ *  ──────────────────────────────────────────────────────────────────────────── */
+template <typename Id, size_t N>
+class IndexedStateController : public IndexedStateMachine {
+private:
+    const char * const * names;
+    const StateTransition<Id> * transitions;
+    std::array<const KPState *, N> states{};
+
+protected:
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Register a state under its id. Its exit codes follow the transition
+     *  table; the callback only captures (this, id) so std::function stores it
+     *  without allocating.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename S>
+    void registerState(const S & state, Id id) {
+        KPStateMachine::registerState(state, names[id], [this, id](int code) { follow(id, code); });
+        states[id] = &KPStateMachine::getState<KPState>(names[id]);
+    }
+
+    template <typename S, typename Transition>
+    void registerState(const S & state, Id id, Transition && transition) {
+        KPStateMachine::registerState(state, names[id], std::forward<Transition>(transition));
+        states[id] = &KPStateMachine::getState<KPState>(names[id]);
+    }
+
+    // Resolve a transition target past the last state
+    virtual void transitionToDynamic(Id target, int code) {
+        halt(TRACE, "Unhandled state transition: ", int(target));
+    }
+
+    void follow(Id from, int code) {
+        transitionRequestedAt = millis();
+        const Id to = code == -1 ? transitions[from].panic : transitions[from].normal;
+
+        exitCode = code;
+        if (size_t(to) >= N) {
+            transitionToDynamic(to, code);
+        } else {
+            KPStateMachine::transitionTo(names[to]);
+        }
+
+        exitCode = 0;
+    }
+
+    template <typename S>
+    S & getState(Id id) {
+        return KPStateMachine::getState<S>(names[id]);
+    }
+
+public:
+    IndexedStateController(const char * name, const char * const (&names)[N],
+                           const StateTransition<Id> (&transitions)[N])
+        : IndexedStateMachine(name), names(names), transitions(transitions) {
+        table = states.data();
+        count = N;
+    }
+
+    void transitionTo(Id id) {
+        transitionRequestedAt = millis();
+        KPStateMachine::transitionTo(names[id]);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Id of the current state, N if none
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    Id currentStateId() {
+        const int index = indexOf(getCurrentState());
+        return index < 0 ? Id(N) : Id(index);
+    }
+
+    bool isInState(Id id) {
+        return getCurrentState() == states[id];
+    }
+};
@@ -3,28 +3,53 @@
 
 void Main::Idle::enter(KPStateMachine & sm) {
     auto & app = *static_cast<App *>(sm.controller);
-    app.pwm.writeAllPumpsOff();
+    app.pumps.stopAll();
+    if (app.startPendingSuccessor()) {
+        return;
+    }
+
     println(app.scheduleNextActiveTask().description());
 };
 
 void Main::Stop::enter(KPStateMachine & sm) {
     auto & app = *static_cast<App *>(sm.controller);
-    app.pwm.writeAllPumpsOff();
+    if (app.taskStateController.lastExitCode() == -1) {
+        app.pumps.allOff();
+    } else {
+        app.pumps.stopAll();
+    }
+
     /*app.pump.off();
     app.shift.writeAllRegistersLow();
     app.intake.off();
     app.sensors.flow.stopMeasurement();*/
 
-    app.vm.setValveStatus(app.status.currentValve, ValveStatus::sampled);
+    // Normal exit already drained the pipeline (its valves started preserving before the
+    // last one), so this only aborts preservation on a panic exit
+    app.pipeline.stop();
+
+    // Sample record (and the transitions leading to it) while the valves are current
+    app.logAfterSample();
+
+    // Copy: marking a valve as sampled removes it from the current valves
+    const std::vector<int> valves = app.status.currentValves;
+    for (auto v : valves) {
+        app.vm.setValveStatus(v, ValveStatus::sampled);
+    }
     app.vm.writeToDirectory();
 
     auto currentTaskId = app.currentTaskId;
     if(currentTaskId){
-        app.tm.advanceTask(currentTaskId);
+        app.tm.advanceTask(currentTaskId, valves.size());
         app.tm.writeToDirectory();
     }
     app.currentTaskId       = 0;
-    app.status.currentValve = -1;
+    sm.next();
+}
+
+void Main::Handoff::enter(KPStateMachine & sm) {
+    auto & app = *static_cast<App *>(sm.controller);
+    app.handOffCurrentValves();
     sm.next();
 }
 
@@ -40,36 +65,30 @@ void TaskStateController::setup() {
     // ..or alternatively if state only has one input and one output
 
 
+    // Every state leaves through the transition table; phase states go to the next
+    // entry of the table compiled from the task's phases
+    registerState(SharedStates::Flush(), FLUSH);
+    registerState(SharedStates::FlushVolume(), FLUSH_VOLUME);
+    registerState(SharedStates::AirFlush(), AIR_FLUSH);
     registerState(SharedStates::Sample(), SAMPLE, [this](int code) {
-        //auto & app = *static_cast<App *>(controller);
+        auto & app = *static_cast<App *>(controller);
         //app.sensors.flow.stopMeasurement();
         //app.logAfterSample();
 
-        switch (code) {
-        //Normal Exit
-        case 0:
-            return transitionTo(PRESERVE_FLUSH);
-        //Pressure above system max, panic exit
-        case -1:
-            return transitionTo(STOP);
-        default:
-            halt(TRACE, "Unhandled state transition: ", code);
+        if (code == 0 && app.shouldPipelineNextValves()) {
+            return transitionTo(HANDOFF);
         }
-    });
 
-    registerState(SharedStates::PreserveFlush(), PRESERVE_FLUSH, [this](int code) {
-        //Pressure above system max, panic exit
-        if (code == -1)
-            return transitionTo(STOP);
-        return transitionTo(PRESERVE);
-    });
-    registerState(SharedStates::Preserve(), PRESERVE, [this](int code) {
-        //Pressure above system max, panic exit
-        if (code == -1)
-            return transitionTo(STOP);
-        return transitionTo(STOP);
+        follow(SAMPLE, code);
     });
+    registerState(SharedStates::Depressure(5), DEPRESSURE);
+    registerState(SharedStates::Dry(), DRY);
+    registerState(SharedStates::OffshootClean(5), OFFSHOOT_CLEAN);
+    registerState(SharedStates::PreserveFlush(), PRESERVE_FLUSH);
+    registerState(SharedStates::Preserve(), PRESERVE);
+    registerState(SharedStates::AlcoholPurge(), ALCOHOL_PURGE);
 
-    registerState(Main::Stop(), STOP, IDLE);
+    registerState(Main::Handoff(), HANDOFF);
+    registerState(Main::Stop(), STOP);
     registerState(Main::Idle(), IDLE);
 };
\ No newline at end of file
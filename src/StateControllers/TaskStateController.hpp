@@ -1,15 +1,71 @@
 #pragma once
 #include <StateControllers/StateControllerBase.hpp>
 #include <States/Shared.hpp>
+#include <Task/Phase.hpp>
+#include <Application/Constants.hpp>
+#include <array>
 
 namespace Main {
-    STATE(IDLE);
-    STATE(SAMPLE);
-    STATE(PRESERVE_FLUSH);
-    STATE(PRESERVE);
-    STATE(STOP);
+    enum StateId : uint8_t {
+        IDLE,
+        FLUSH,
+        FLUSH_VOLUME,
+        AIR_FLUSH,
+        SAMPLE,
+        DEPRESSURE,
+        DRY,
+        OFFSHOOT_CLEAN,
+        PRESERVE_FLUSH,
+        PRESERVE,
+        ALCOHOL_PURGE,
+        STOP,
+        HANDOFF,
+        NUMBER_OF_STATES,
+        // Transition target: next entry of the table compiled from the task's phases
+        NEXT_PHASE = NUMBER_OF_STATES
+    };
+
+    constexpr const char * STATE_NAMES[NUMBER_OF_STATES] = {
+        "IDLE_STATE", "FLUSH_STATE", "FLUSH_VOLUME_STATE", "AIR_FLUSH_STATE", "SAMPLE_STATE",
+        "DEPRESSURE_STATE", "DRY_STATE", "OFFSHOOT_CLEAN_STATE", "PRESERVE_FLUSH_STATE",
+        "PRESERVE_STATE", "ALCOHOL_PURGE_STATE", "STOP_STATE", "HANDOFF_STATE"};
+
+    // Phase states -> next phase (pressure panic -> STOP) ... -> STOP -> IDLE
+    constexpr StateTransition<StateId> TRANSITIONS[NUMBER_OF_STATES] = {
+        /* IDLE           */ {IDLE, IDLE},
+        /* FLUSH          */ {NEXT_PHASE, STOP},
+        /* FLUSH_VOLUME   */ {NEXT_PHASE, STOP},
+        /* AIR_FLUSH      */ {NEXT_PHASE, STOP},
+        /* SAMPLE         */ {NEXT_PHASE, STOP},
+        /* DEPRESSURE     */ {NEXT_PHASE, STOP},
+        /* DRY            */ {NEXT_PHASE, STOP},
+        /* OFFSHOOT_CLEAN */ {NEXT_PHASE, STOP},
+        /* PRESERVE_FLUSH */ {NEXT_PHASE, STOP},
+        /* PRESERVE       */ {NEXT_PHASE, STOP},
+        /* ALCOHOL_PURGE  */ {NEXT_PHASE, STOP},
+        /* STOP           */ {IDLE, IDLE},
+        /* HANDOFF        */ {SAMPLE, STOP}};
+
+    // State running each Phase::Type, in enum order
+    constexpr StateId PHASE_STATES[Phase::count] = {
+        FLUSH, FLUSH_VOLUME, AIR_FLUSH, SAMPLE, DEPRESSURE,
+        DRY, OFFSHOOT_CLEAN, PRESERVE_FLUSH, PRESERVE, ALCOHOL_PURGE};
+
+    constexpr bool phaseStatesFollowTable() {
+        for (auto id : PHASE_STATES) {
+            if (TRANSITIONS[id].normal != NEXT_PHASE || TRANSITIONS[id].panic != STOP) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(isValidTransitionTable(TRANSITIONS, 1), "Unknown transition target");
+    static_assert(phaseStatesFollowTable(), "Phase states must go to the next phase or STOP");
+    static_assert(TRANSITIONS[STOP].normal == IDLE, "STOP must lead to IDLE");
+    static_assert(TRANSITIONS[HANDOFF].normal == SAMPLE, "HANDOFF must lead back to SAMPLE");
 
-    
     /**
      * This state checks if there is an active task and schedule it if any.
      * [Connections: 0]
@@ -29,33 +85,84 @@ namespace Main {
         void enter(KPStateMachine & sm) override;
     };
 
+    /**
+     * Pipelined tasks only. Hand the valves that just finished sampling over to the
+     * preservation pipeline and mark the next valves as operating.
+     * [Connections: 1]
+     */
+    class Handoff : public KPState {
+    public:
+        void enter(KPStateMachine & sm) override;
+    };
+
     struct Config {
-        decltype(SharedStates::Sample::time) sampleTime;
-        decltype(SharedStates::PreserveFlush::time) preserveDrawTime;
-        decltype(SharedStates::Preserve::time) preserveTime;
+        std::array<Phase, TaskSettings::MAX_PHASES> phases;
+        size_t numberOfPhases = 0;
+        // Target of the sample phases in mL, 0 to sample for their time
+        float sampleVolume = 0;
     };
 
-    class Controller : public StateController, public StateControllerConfig<Config> {
-    public:
-        Controller() : StateController("task-state-controller") {}
+    class Controller : public IndexedStateController<StateId, NUMBER_OF_STATES>,
+                       public StateControllerConfig<Config> {
+    private:
+        // Compiled from config.phases by begin(): state of each phase
+        std::array<StateId, TaskSettings::MAX_PHASES> table;
+        size_t cursor = 0;
 
-        void setup();
-        void configureStates() {
+        template <typename T>
+        void enterPhase(StateId id, long time) {
+            getState<T>(id).time = time;
+            transitionTo(id);
+        }
 
-            decltype(auto) sample = getState<SharedStates::Sample>(SAMPLE);
-            sample.time           = config.sampleTime;
+        /** ────────────────────────────────────────────────────────────────────────────
+         *  @brief Configure and enter the phase at the given position of the table,
+         *  or STOP past the last one
+         *  ──────────────────────────────────────────────────────────────────────────── */
+        void enterPhase(size_t index) {
+            cursor = index;
+            if (index >= config.numberOfPhases) {
+                return transitionTo(STOP);
+            }
 
-            decltype(auto) preserve_flush = getState<SharedStates::PreserveFlush>(PRESERVE_FLUSH);
-            preserve_flush.time           = config.preserveDrawTime;
+            using namespace SharedStates;
+            const StateId id = table[index];
+            const long time  = config.phases[index].time;
+            switch (id) {
+            case FLUSH: return enterPhase<Flush>(id, time);
+            case FLUSH_VOLUME: return enterPhase<FlushVolume>(id, time);
+            case AIR_FLUSH: return enterPhase<AirFlush>(id, time);
+            case SAMPLE:
+                getState<Sample>(id).volume = config.sampleVolume;
+                return enterPhase<Sample>(id, time);
+            case DEPRESSURE: return enterPhase<Depressure>(id, time);
+            case DRY: return enterPhase<Dry>(id, time);
+            case OFFSHOOT_CLEAN: return enterPhase<OffshootClean>(id, time);
+            case PRESERVE_FLUSH: return enterPhase<PreserveFlush>(id, time);
+            case PRESERVE: return enterPhase<Preserve>(id, time);
+            case ALCOHOL_PURGE: return enterPhase<AlcoholPurge>(id, time);
+            default: halt(TRACE, "Invalid phase: ", int(id));
+            }
+        }
 
-            decltype(auto) preserve = getState<SharedStates::Preserve>(PRESERVE);
-            preserve.time           = config.preserveTime;
+        void transitionToDynamic(StateId target, int code) override {
+            enterPhase(cursor + 1);
         }
 
+    public:
+        Controller()
+            : IndexedStateController("task-state-controller", STATE_NAMES, TRANSITIONS) {}
+
+        void setup() override;
+
         void begin() override {
-            configureStates();
-            println("transitioning to sample");
-            transitionTo(SAMPLE);
+            for (size_t i = 0; i < config.numberOfPhases; i++) {
+                table[i] = PHASE_STATES[config.phases[i].type];
+            }
+
+            println("transitioning to ",
+                    STATE_NAMES[config.numberOfPhases ? table[0] : STOP]);
+            enterPhase(size_t(0));
         }
 
         void stop() override {
@@ -67,7 +174,23 @@ namespace Main {
         }
 
         bool isStop() {
-            return getCurrentState()->getName() == STOP;
+            return isInState(STOP);
+        }
+
+        bool isIdle() {
+            return isInState(IDLE);
+        }
+
+        /** ────────────────────────────────────────────────────────────────────────────
+         *  @brief Phase of the compiled table being run, nullptr outside of the phases
+         *  (IDLE, STOP, HANDOFF)
+         *  ──────────────────────────────────────────────────────────────────────────── */
+        const Phase * currentPhase() {
+            if (cursor >= config.numberOfPhases || !isInState(table[cursor])) {
+                return nullptr;
+            }
+
+            return &config.phases[cursor];
         }
     };
 };  // namespace Name
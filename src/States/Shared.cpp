@@ -1,5 +1,6 @@
 #include <States/Shared.hpp>
 #include <Application/App.hpp>
+#include <Task/Phase.hpp>
 
 namespace SharedStates {
     void Idle::enter(KPStateMachine & sm) {
@@ -8,21 +9,14 @@ namespace SharedStates {
     }
 
     void Stop::enter(KPStateMachine & sm) {
+        // Only used by HyperFlush, which never samples: nothing to commit to the valve
+        // or task managers
         auto & app = *static_cast<App *>(sm.controller);
-        app.pwm.writeAllPumpsOff();
+        app.pumps.stopAll();
         /*app.pump.off();
         app.shift.writeAllRegistersLow();
         app.intake.off();
         app.sensors.flow.stopMeasurement();*/
-        app.vm.setValveStatus(app.status.currentValve, ValveStatus::sampled);
-        app.vm.writeToDirectory();
-
-        auto currentTaskId = app.currentTaskId;
-        app.tm.advanceTask(currentTaskId);
-        app.tm.writeToDirectory();
-
-        app.currentTaskId       = 0;
-        app.status.currentValve = -1;
         sm.next();
     }
 
@@ -51,26 +45,7 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        // To next state after 10 secs
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-    void Flush::update(KPStateMachine & sm) {
-        //don't update valve status during first 5 seconds
-        //because valve isn't supposed to be on
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        // returns if it has already updated in the last second
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-        /*auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);
-        app.shift.write();*/
+        setTimeCondition(time + Phase::padding(Phase::flush), [&]() { sm.next(0); });
     }
 
     void Flush::leave(KPStateMachine & sm) {
@@ -106,25 +81,9 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); });*/
 
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-    void FlushVolume::update(KPStateMachine & sm) {
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-        /*auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);
-        app.shift.write();*/
+        setTimeCondition(time + Phase::padding(Phase::flushVolume), [&]() { sm.next(0); });
     }
 
-
     void AirFlush::enter(KPStateMachine & sm) {
         /*auto & app = *static_cast<App *>(sm.controller);
         app.shift.writeAllRegistersLow();
@@ -146,43 +105,41 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); });*/
 
-        setTimeCondition(time + 1, [&]() { sm.next(0); });
-    }
-
-    void AirFlush::update(KPStateMachine & sm) {
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-        /*auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::AIR_VALVE, HIGH);
-        app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);
-        app.shift.write();*/
+        setTimeCondition(time + Phase::padding(Phase::airFlush), [&]() { sm.next(0); });
     }
 
     void Sample::enter(KPStateMachine & sm) {
         // We set the latch valve to intake mode, turn on the filter valve, then the pump
         auto & app = *static_cast<App *>(sm.controller); 
-        app.pwm.writePump(app.currentValveIdToPin(), PumpStatus::forwards);
-        setTimeCondition(time, [&]() { sm.next(0); });
-    }
-
-    void Sample::update(KPStateMachine & sm){
-        if(timeSinceLastTransition() < 5000){
-            return;
+        // Before the pumps start: the controller reads its pressure baseline, unless it
+        // was held before priming
+        app.flowController.start(app.currentValvePins(), millis() + secsToMillis(time));
+        app.pumps.writeAll(app.currentValvePins(), PumpStatus::forwards);
+        app.status.flowDidStart();
+        // Stop on the millisecond even if the loop is late for the transition
+        app.pumps.scheduleAll(app.currentValvePins(), PumpStatus::off, millis() + secsToMillis(time));
+
+        const bool byVolume = volume > 0 && app.flow.canEstimate(app.currentValvePins());
+        if (volume > 0 && !byVolume) {
+            println(BROWN("No flow calibration for every valve, sampling for "), time, " s");
         }
 
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
+        app.flow.start(app.currentValvePins(), byVolume ? volume : 0);
+        if (byVolume) {
+            setCondition([&app]() { return app.flow.didReachTarget(); }, [&]() {
+                app.pumps.writeAll(app.currentValvePins(), PumpStatus::off);
+                sm.next(0);
+            });
         }
 
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(app.currentValveIdToPin(), HIGH);
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::sample), [&]() { sm.next(0); });
+    }
+
+    void Sample::leave(KPStateMachine & sm) {
+        auto & app = *static_cast<App *>(sm.controller);
+        app.flowController.stop();
+        app.flow.stop();
+        println("Sampled ", app.status.sampleVolume, " mL (estimated)");
     }
 
     void Depressure::enter(KPStateMachine & sm){
@@ -196,18 +153,7 @@ namespace SharedStates {
             app.pump.on(Direction::reverse);
         }); */
 
-        setTimeCondition(time + 5, [&]() { sm.next(); });
-    }
-
-    void Depressure::update(KPStateMachine & sm){
-        //Goal is to reduce pressure before going into next state.
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-/* 
-        auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::depressure), [&]() { sm.next(); });
     }
 
     void Dry::enter(KPStateMachine & sm) {
@@ -235,23 +181,7 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-    void Dry::update(KPStateMachine & sm) {
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::AIR_VALVE, HIGH);
-        app.shift.setPin(app.currentValveIdToPin(), HIGH);
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::dry), [&]() { sm.next(0); });
     }
 
     void OffshootClean::enter(KPStateMachine & sm) {
@@ -285,78 +215,67 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        setTimeCondition(time + 7, [&]() { sm.next(0); });
+        setTimeCondition(time + Phase::padding(Phase::offshootClean), [&]() { sm.next(0); });
     };
 
-    void OffshootClean::update(KPStateMachine & sm){
-        if( timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(app.currentValveIdToPin(), HIGH);
-        app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);
-        app.shift.write(); */
-    }
-
-    void OffshootPreload::update(KPStateMachine & sm){
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.write(); */
-    }
-
     void OffshootPreload::enter(KPStateMachine & sm) {
-        // RIGHT NOW THIS IS DESIGNED FOR TWO CHANNEL ONLY
         // Intake valve is opened and the motor is runnning ...
         // Turnoff only the flush valve
         auto & app = *static_cast<App *>(sm.controller);
 
-        
-        // Reserving space ahead of time for performance
-        reserve(3);
-        println("Begin preloading procedure for ", 2, " valves...");
-
-        int counter      = 0;
-        int prevValvePin = -1;
-        //just 0 and 1 for now
-        for (int i = 0; i < 2; i++) {
-            if (app.vm.valves[i].status == ValveStatus::unavailable) {
+        // Split the valves into stages: same group, at most `parallelism` valves each
+        std::vector<std::vector<int>> stages;
+        std::vector<const char *> stageGroups;
+        int count = 0;
+        for (const Valve & valve : app.vm.valves) {
+            if (valve.status == ValveStatus::unavailable || valve.status == ValveStatus::sampled) {
                 continue;
             }
 
-            // Skip the first register
-            auto valvePin = app.vm.valves[i].id;
-            setTimeCondition(counter * preloadTime, [&app, prevValvePin, valvePin]() {
-                if (prevValvePin != -1) {
-                    // Turn off the previous valve
-                    app.pwm.writePump(prevValvePin, PumpStatus::off);
+            size_t i = 0;
+            while (i < stages.size()
+                   && (strcmp(stageGroups[i], valve.group) != 0
+                       || (parallelism > 0 && stages[i].size() >= size_t(parallelism)))) {
+                i++;
+            }
+
+            if (i == stages.size()) {
+                stages.emplace_back();
+                stageGroups.push_back(valve.group);
+            }
+
+            stages[i].push_back(valve.id);
+            count++;
+        }
+
+        // Reserving space ahead of time for performance
+        reserve(stages.size() + 1);
+        println("Begin preloading procedure for ", count, " valves in ", stages.size(), " stages...");
+
+        // Each stage is stopped on time by the actuator; the writes below only catch
+        // the stops it could not take
+        const unsigned long start = millis();
+        std::vector<int> previous;
+        for (size_t i = 0; i < stages.size(); i++) {
+            setTimeCondition(i * preloadTime, [&app, previous, current = stages[i],
+                                               end = start + secsToMillis((i + 1) * preloadTime)]() {
+                app.pumps.writeAll(previous, PumpStatus::off);
+                if (!previous.empty()) {
                     println("done");
                 }
 
-                app.pwm.writePump(valvePin, PumpStatus::forwards);
-                
-                print("Flushing offshoot ", valvePin, "...");
+                app.pumps.writeAll(current, PumpStatus::forwards);
+                app.pumps.scheduleAll(current, PumpStatus::off, end);
+
+                print("Flushing ", current.size(), " offshoot(s) from valve ", current.front(), "...");
             });
 
-            prevValvePin = valvePin;
-            counter++;
+            previous = stages[i];
         }
 
-        // Transition to the next state after the last valve
-        setTimeCondition(counter * preloadTime, [&]() {
+        // Transition to the next state after the last stage
+        setTimeCondition(stages.size() * preloadTime, [&, previous]() {
+            app.pumps.writeAll(previous, PumpStatus::off);
             println("done");
             sm.next();
         });
@@ -364,7 +283,7 @@ namespace SharedStates {
 
     void Preserve::enter(KPStateMachine & sm) {
         auto & app = *static_cast<App *>(sm.controller); 
-        app.pwm.writePumpVariable(app.currentValveIdToPin(), 1600);
+        app.pumps.writeAllVariable(app.currentValvePins(), PumpSettings::PRESERVE);
         /*
         app.pump.off();
         app.shift.writeAllRegistersLow();
@@ -389,29 +308,12 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-
-    void Preserve::update(KPStateMachine & sm){
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::ALCHOHOL_VALVE, HIGH);
-        app.shift.setPin(app.currentValveIdToPin(), HIGH);
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::preserve), [&]() { sm.next(0); });
     }
 
   void PreserveFlush::enter(KPStateMachine & sm) {
         auto & app = *static_cast<App *>(sm.controller); 
-        app.pwm.writePump(app.currentValveIdToPin(), PumpStatus::backwards);
+        app.pumps.writeAll(app.currentValvePins(), PumpStatus::backwards);
         /*
         app.pump.off();
         app.shift.writeAllRegistersLow();
@@ -436,23 +338,7 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-    void PreserveFlush::update(KPStateMachine & sm){
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::ALCHOHOL_VALVE, HIGH);
-        app.shift.setPin(app.currentValveIdToPin(), HIGH);
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::preserveFlush), [&]() { sm.next(0); });
     }
 
     void AlcoholPurge::enter(KPStateMachine & sm) {
@@ -479,23 +365,7 @@ namespace SharedStates {
 
         setCondition(max_system_condition, [&]() { sm.next(-1); }); */
 
-        setTimeCondition(time + 6, [&]() { sm.next(0); });
-    }
-
-    void AlcoholPurge::update(KPStateMachine & sm){
-        if(timeSinceLastTransition() < 5000){
-            return;
-        }
-        if ((unsigned long) (millis() - updateTime) < updateDelay) {
-            return;
-        }
-
-        updateTime = millis();
-/*         auto & app = *static_cast<App *>(sm.controller);
-        app.shift.setAllRegistersLow();
-        app.shift.setPin(TPICDevices::ALCHOHOL_VALVE, HIGH);
-        app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);
-        app.shift.write(); */
+        setTimeCondition(time + Phase::padding(Phase::alcoholPurge), [&]() { sm.next(0); });
     }
 
 }  // namespace SharedStates
\ No newline at end of file
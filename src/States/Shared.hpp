@@ -1,7 +1,21 @@
 #pragma once
 #include <KPState.hpp>
+#include <Components/DeadlineScheduler.hpp>
 
 namespace SharedStates {
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  Base of the states that wait with setTimeCondition: also registers the time
+     *  with the DeadlineScheduler so the main loop wakes up when the condition is due.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    class TimedState : public KPState {
+    protected:
+        template <typename F>
+        void setTimeCondition(unsigned long seconds, F && callback) {
+            KPState::setTimeCondition(seconds, std::forward<F>(callback));
+            DeadlineScheduler::sharedInstance().wakeIn(secsToMillis(seconds));
+        }
+    };
+
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
@@ -26,13 +40,10 @@ namespace SharedStates {
      *
      *	@param time Flush time
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class Flush : public KPState {
+    class Flush : public TimedState {
     public:
         unsigned long time = 10;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
         void leave(KPStateMachine & sm) override;
     };
 
@@ -40,134 +51,109 @@ namespace SharedStates {
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class FlushVolume : public KPState {
+    class FlushVolume : public TimedState {
     public:
         unsigned long time   = 10;
         unsigned long volume = 1000;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class AirFlush : public KPState {
+    class AirFlush : public TimedState {
     public:
         unsigned long time = 15;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class Sample : public KPState {
+    class Sample : public TimedState {
     public:
         unsigned long time = 150;
         float pressure     = 8;
-        float volume       = 1000;
+        // Target volume (mL), 0 to sample for the whole time. Needs a flow calibration
+        // of every sampled channel; time stays the limit.
+        float volume       = 0;
 
         const char * condition;
 
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
+        void leave(KPStateMachine & sm) override;
     };
 
-    class Depressure : public KPState {
+    class Depressure : public TimedState {
     public:
         unsigned long time = 5;
         Depressure(unsigned long time) : time(time) {}
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class Dry : public KPState {
+    class Dry : public TimedState {
     public:
         unsigned long time = 10;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class OffshootClean : public KPState {
+    class OffshootClean : public TimedState {
     public:
         unsigned long time = 5;
         OffshootClean(unsigned long time) : time(time) {}
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
         //void leave(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
-     *
-     *
+     *  Preload the offshoot of every valve that is neither unavailable nor sampled.
+     *  Valves of the same group run together in stages of at most `parallelism`
+     *  valves (0 for the whole group), each stage running for preloadTime seconds.
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class OffshootPreload : public KPState {
+    class OffshootPreload : public TimedState {
     public:
         int preloadTime = 5;
+        int parallelism = 1;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class Preserve : public KPState {
+    class Preserve : public TimedState {
     public:
         unsigned long time = 0;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *
      *
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class PreserveFlush : public KPState {
+    class PreserveFlush : public TimedState {
     public:
         unsigned long time = 0;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 
     /** ────────────────────────────────────────────────────────────────────────────
      *  A state used to remove air bubbles from a alcohol bag
      *  also used to saturate lower hydrolics with preservative
      *  ──────────────────────────────────────────────────────────────────────────── */
-    class AlcoholPurge : public KPState {
+    class AlcoholPurge : public TimedState {
     public:
         unsigned long time = 10;
         void enter(KPStateMachine & sm) override;
-        unsigned long updateTime = millis();
-        unsigned long updateDelay = 1000;
-        void update(KPStateMachine & sm) override;
     };
 }  // namespace SharedStates
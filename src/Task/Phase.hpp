@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+//
+// ──────────────────────────────────────────────────── I ──────────
+//   :::::: P H A S E : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────
+//
+// One step of a valve cycle. A task lists its phases in order; TaskStateController compiles
+// the list into its transition table when the task is configured. Only depends on the
+// standard library so TaskPlanner can use the same durations on the host.
+//
+struct Phase {
+    enum Type : uint8_t {
+        flush,
+        flushVolume,
+        airFlush,
+        sample,
+        depressure,
+        dry,
+        offshootClean,
+        preserveFlush,
+        preserve,
+        alcoholPurge,
+        count,
+        invalid = 0xFF
+    };
+
+    Type type = invalid;
+    long time = 0;
+
+    static const char * name(Type type) {
+        static const char * const names[count] = {
+            "flush", "flushVolume", "airFlush", "sample", "depressure",
+            "dry", "offshootClean", "preserveFlush", "preserve", "alcoholPurge"};
+        return type < count ? names[type] : "invalid";
+    }
+
+    static Type parse(const char * name) {
+        for (uint8_t i = 0; name && i < count; i++) {
+            if (strcmp(name, Phase::name(Type(i))) == 0) {
+                return Type(i);
+            }
+        }
+
+        return invalid;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Seconds the matching SharedStates state waits on top of its time. The
+     *  states, PreservationPipeline and TaskPlanner all read it from here.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    static constexpr long padding(Type type) {
+        return type == sample ? 0
+             : type == airFlush ? 1
+             : type == depressure ? 5
+             : type == offshootClean ? 7
+             : 6;
+    }
+
+    long duration() const {
+        return time + padding(type);
+    }
+};
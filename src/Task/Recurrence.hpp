@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+
+//
+// ──────────────────────────────────────────────────────────── I ──────────
+//   :::::: R E C U R R E N C E : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────
+//
+// Recurring schedule anchored to an absolute origin. Occurrences are never stored: the
+// next one is computed from the origin when needed, so a run that overruns does not push
+// back any of the following ones.
+//
+// Either an interval (every N seconds since origin) or cron-like masks (the minute and
+// second of origin, on every selected hour of every selected weekday, UTC).
+//
+struct Recurrence {
+    // Shortest time (s) between two valves of a task (TaskManager::advanceTask)
+    static constexpr long MIN_TIME_BETWEEN = 5;
+
+    long origin       = 0;  // Unix time every occurrence is aligned to
+    long interval     = 0;  // Seconds between occurrences, 0 to use the masks instead
+    uint8_t dayMask   = 0;  // Bit 0 = Sunday ... bit 6 = Saturday
+    uint32_t hourMask = 0;  // Bit h = hour h
+
+    bool isEnabled() const {
+        return interval > 0 || ((dayMask & 0x7F) != 0 && (hourMask & 0xFFFFFF) != 0);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Compute the first occurrence strictly after the given time
+     *
+     *  @param time Unix time
+     *  @return long Next occurrence, or 0 if the recurrence is disabled
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long nextAfter(long time) const {
+        if (!isEnabled()) {
+            return 0;
+        }
+
+        if (interval > 0) {
+            return time < origin ? origin : origin + ((time - origin) / interval + 1) * interval;
+        }
+
+        if (time < origin) {
+            time = origin - 1;
+        }
+
+        // Walk hour by hour, at most one week ahead
+        constexpr long HOUR = 3600;
+        constexpr long DAY  = 24 * HOUR;
+        long candidate      = time - time % HOUR + origin % HOUR;
+        if (candidate <= time) {
+            candidate += HOUR;
+        }
+
+        for (int i = 0; i <= 7 * 24; i++, candidate += HOUR) {
+            const int weekday = (candidate / DAY + 4) % 7;  // 1 Jan 1970 was a Thursday
+            const int hour    = (candidate % DAY) / HOUR;
+            if ((dayMask & (1 << weekday)) && (hourMask & (1UL << hour))) {
+                return candidate;
+            }
+        }
+
+        return 0;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Schedule of a task's next valve once the previous one finished. Recurring
+     *  tasks stay aligned to their origin, others wait timeBetween after the run.
+     *
+     *  @param timeBetween Seconds between valves for non-recurring tasks
+     *  @param finishedAt Time at which the previous valve stopped
+     *  @return long Next schedule
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long nextSchedule(long timeBetween, long finishedAt) const {
+        if (isEnabled()) {
+            return nextAfter(finishedAt + MIN_TIME_BETWEEN - 1);
+        }
+
+        return finishedAt + (timeBetween > MIN_TIME_BETWEEN ? timeBetween : MIN_TIME_BETWEEN);
+    }
+};
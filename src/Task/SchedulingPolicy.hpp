@@ -0,0 +1,81 @@
+#pragma once
+
+//
+// ──────────────────────────────────────────────────────────────────────── I ──────────
+//   :::::: S C H E D U L I N G   P O L I C Y : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────────────
+//
+// Decides which of the tasks that are due runs first and when a late task is given up.
+// Tasks that are not due yet are always ordered by schedule. Like TaskPlanner, this only
+// depends on plain types so the planner can replay the exact same decisions on the host.
+//
+struct SchedulingKey {
+    long schedule  = 0;
+    int priority   = 0;
+    long tolerance = 0;  // Seconds a task may start after its schedule
+
+    long deadline() const {
+        return schedule + tolerance;
+    }
+
+    bool isDue(long time) const {
+        return schedule <= time;
+    }
+};
+
+class SchedulingPolicy {
+public:
+    virtual ~SchedulingPolicy() = default;
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Order between two tasks that are both due
+     *
+     *  @return true if a should run before b
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    virtual bool runsBefore(const SchedulingKey & a, const SchedulingKey & b) const = 0;
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Whether a task can no longer be started at the given time
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    virtual bool isMissed(const SchedulingKey & key, long time) const = 0;
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Full ordering used to sort active tasks at the given time. Due tasks come
+     *  first in policy order, followed by upcoming tasks sorted by schedule.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool runsBefore(const SchedulingKey & a, const SchedulingKey & b, long time) const {
+        const bool aDue = a.isDue(time);
+        const bool bDue = b.isDue(time);
+        if (aDue != bDue) {
+            return aDue;
+        }
+
+        return aDue ? runsBefore(a, b) : a.schedule < b.schedule;
+    }
+};
+
+/** ────────────────────────────────────────────────────────────────────────────
+ *  @brief Default policy. Higher priority first, then earliest deadline
+ *  (schedule + tolerance). A late task still runs as long as its deadline has not
+ *  passed.
+ *  ──────────────────────────────────────────────────────────────────────────── */
+class EarliestDeadlineFirst : public SchedulingPolicy {
+public:
+    using SchedulingPolicy::runsBefore;
+
+    bool runsBefore(const SchedulingKey & a, const SchedulingKey & b) const override {
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+
+        if (a.deadline() != b.deadline()) {
+            return a.deadline() < b.deadline();
+        }
+
+        return a.schedule < b.schedule;
+    }
+
+    bool isMissed(const SchedulingKey & key, long time) const override {
+        return time > key.deadline();
+    }
+};
@@ -9,6 +9,8 @@
 #include <Utilities/JsonFileLoader.hpp>
 
 #include <Task/TaskStatus.hpp>
+#include <Task/Recurrence.hpp>
+#include <Task/Phase.hpp>
 #include <StateControllers/TaskStateController.hpp>
 
 struct Task : public JsonEncodable,
@@ -29,9 +31,34 @@ public:
     int timeBetween = 0;
 
     int sampleTime     = 0;
+    // mL; when set, sampling stops once the calibrated flow adds up to it, with
+    // sampleTime as the limit
+    float sampleVolume = 0;
     int preserveDrawTime   = 0;
     int preserveTime   = 0;
 
+    // Scheduling: higher priority runs first among due tasks. A negative tolerance uses
+    // the default from config.
+    int priority           = 0;
+    long latenessTolerance = -1;
+
+    // Optional recurrence. Each occurrence samples the next valve.
+    Recurrence recurrence;
+
+    // Id of the task started as soon as this one completes (0 for none)
+    int successor = 0;
+
+    // Number of valves sampled at the same time, bounded by Config::maxConcurrentPumps
+    int concurrency = 1;
+
+    // Start sampling the next valves while the previous ones are still being preserved.
+    // timeBetween is ignored between the valves of a pipelined task.
+    bool pipelined = false;
+
+    // Phases of each valve cycle, in order. Empty for the default
+    // sample -> preserveFlush -> preserve chain using the times above.
+    std::vector<Phase> phases;
+
     bool deleteOnCompletion = false;
 
     std::vector<uint8_t> valves;
@@ -60,6 +87,22 @@ public:
         return status == TaskStatus::completed;
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Align the schedule of a recurring task to its first occurrence at or
+     *  after the current schedule. The schedule becomes the origin if none was given.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void anchorRecurrence() {
+        if (!recurrence.isEnabled()) {
+            return;
+        }
+
+        if (recurrence.origin == 0) {
+            recurrence.origin = schedule;
+        }
+
+        schedule = recurrence.nextAfter(schedule - 1);
+    }
+
     /** ────────────────────────────────────────────────────────────────────────────
      *  @brief Get the Current Valve ID
      *
@@ -69,6 +112,98 @@ public:
         return (getValveOffsetStart() >= getNumberOfValves()) ? -1 : valves[getValveOffsetStart()];
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Get the number of valves run together in the next cycle
+     *
+     *  @param maxConcurrentPumps Limit on simultaneously running pumps
+     *  @return int Valves starting at the current valve offset, 0 if none is left
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    int getNextBatchSize(int maxConcurrentPumps) const {
+        const int remaining = getNumberOfValves() - getValveOffsetStart();
+        return std::max(0, std::min({std::max(concurrency, 1), maxConcurrentPumps, remaining}));
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Phases a valve cycle of this task goes through
+     *
+     *  @return std::vector<Phase> The task's phases, or the default chain
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    std::vector<Phase> getPhases() const {
+        if (!phases.empty()) {
+            return phases;
+        }
+
+        return {{Phase::sample, sampleTime},
+                {Phase::preserveFlush, preserveDrawTime},
+                {Phase::preserve, preserveTime}};
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Seconds from the first phase to STOP for one valve cycle
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    long getCycleTime() const {
+        long total = 0;
+        for (const auto & phase : getPhases()) {
+            total += phase.duration();
+        }
+
+        return total;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Check that the phases can be compiled by TaskStateController
+     *
+     *  @return const char * Error message, nullptr if the phases are valid
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    const char * validatePhases() const {
+        if (phases.empty()) {
+            return nullptr;
+        }
+
+        if (phases.size() > TaskSettings::MAX_PHASES) {
+            return "Too many phases";
+        }
+
+        int samples = 0;
+        for (const auto & phase : phases) {
+            if (phase.type >= Phase::count) {
+                return "Unknown phase type";
+            }
+
+            if (phase.time < 0) {
+                return "Phase time must not be negative";
+            }
+
+            switch (phase.type) {
+            case Phase::sample:
+                break;
+            case Phase::preserveFlush:
+            case Phase::preserve:
+                // Preserving a valve that has not been sampled wastes its preservative
+                if (samples == 0) {
+                    return "Preservation phases must come after the sample phase";
+                }
+
+                break;
+            default:
+                // These states only wait out their time until their hardware is ported
+                return "Phase is not supported by this hardware yet";
+            }
+
+            samples += phase.type == Phase::sample;
+        }
+
+        if (samples != 1) {
+            return "Phases must include exactly one sample phase";
+        }
+
+        if (pipelined) {
+            return "Pipelined tasks use the default phases";
+        }
+
+        return nullptr;
+    }
+
 #pragma region JSONDECODABLE
     static const char * decoderName() {
         return "Task";
@@ -106,9 +241,31 @@ public:
         }
         status         = source[STATUS];
         sampleTime     = source[SAMPLE_TIME];
+        sampleVolume   = source[SAMPLE_VOLUME] | 0.0f;
         preserveDrawTime   = source[PRESERVE_TIME_DRAW];
         preserveTime   = source[PRESERVE_TIME];
         timeBetween    = source[TIME_BETWEEN];
+        priority       = source[PRIORITY] | 0;
+        latenessTolerance = source[LATENESS_TOLERANCE] | -1;
+        recurrence.origin   = source[RECURRENCE_ORIGIN] | 0L;
+        recurrence.interval = source[RECURRENCE_INTERVAL] | 0L;
+        recurrence.dayMask  = source[RECURRENCE_DAYS] | 0;
+        recurrence.hourMask = source[RECURRENCE_HOURS] | 0UL;
+        successor           = source[SUCCESSOR] | 0;
+        concurrency         = source[CONCURRENCY] | 1;
+        pipelined           = source[PIPELINED] | false;
+
+        if (source.containsKey(PHASES)) {
+            JsonArrayConst phase_array = source[PHASES].as<JsonArrayConst>();
+            phases.clear();
+            phases.reserve(phase_array.size());
+            for (JsonObjectConst object : phase_array) {
+                Phase phase;
+                phase.type = Phase::parse(object[PHASE_TYPE]);
+                phase.time = object[PHASE_TIME] | 0L;
+                phases.push_back(phase);
+            }
+        }
     }
 #pragma endregion
 #pragma region JSONENCODABLE
@@ -123,6 +280,15 @@ public:
 
     bool encodeJSON(const JsonVariant & dst) const override {
         using namespace TaskKeys;
+        JsonArray phase_array = dst.createNestedArray(PHASES);
+        for (const auto & phase : phases) {
+            JsonObject object = phase_array.createNestedObject();
+            if (!object[PHASE_TYPE].set(Phase::name(phase.type))
+                || !object[PHASE_TIME].set(phase.time)) {
+                return false;
+            }
+        }
+
         // clang-format off
 		return dst[ID].set(id) 
 			&& dst[NAME].set((char *)name) 
@@ -131,11 +297,21 @@ public:
 			&& dst[CREATED_AT].set(createdAt)
 			&& dst[SCHEDULE].set(schedule) 
 			&& dst[SAMPLE_TIME].set(sampleTime)
+			&& dst[SAMPLE_VOLUME].set(sampleVolume)
 			&& dst[PRESERVE_TIME_DRAW].set(preserveDrawTime)
 			&& dst[PRESERVE_TIME].set(preserveTime)
 			&& dst[TIME_BETWEEN].set(timeBetween) 
 			&& dst[VALVES_OFFSET].set(getValveOffsetStart())
 			&& dst[DELETE].set(deleteOnCompletion)
+			&& dst[PRIORITY].set(priority)
+			&& dst[LATENESS_TOLERANCE].set(latenessTolerance)
+			&& dst[RECURRENCE_ORIGIN].set(recurrence.origin)
+			&& dst[RECURRENCE_INTERVAL].set(recurrence.interval)
+			&& dst[RECURRENCE_DAYS].set(recurrence.dayMask)
+			&& dst[RECURRENCE_HOURS].set(recurrence.hourMask)
+			&& dst[SUCCESSOR].set(successor)
+			&& dst[CONCURRENCY].set(concurrency)
+			&& dst[PIPELINED].set(pipelined)
 			&& copyArray(valves.data(), valves.size(), dst.createNestedArray(VALVES));
 	}  // clang-format on
 
@@ -148,8 +324,9 @@ public:
 #pragma endregion
 
     void operator()(TaskStateController::Config & config) const {
-        config.sampleTime     = sampleTime;
-        config.preserveDrawTime   = preserveDrawTime;
-        config.preserveTime   = preserveTime;
+        const auto compiled   = getPhases();
+        config.numberOfPhases = std::min(compiled.size(), config.phases.size());
+        std::copy_n(compiled.begin(), config.numberOfPhases, config.phases.begin());
+        config.sampleVolume = sampleVolume;
     }
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include <Task/Task.hpp>
 #include <Task/TaskObserver.hpp>
+#include <Task/SchedulingPolicy.hpp>
 #include <Application/Config.hpp>
 
 #include <vector>
@@ -19,13 +20,47 @@ public:
     using EntryType      = CollectionType::value_type;
     CollectionType tasks;
 
+private:
+    EarliestDeadlineFirst defaultPolicy;
+    const SchedulingPolicy * policy = nullptr;
+
 public:
     const char * taskFolder = nullptr;
+    long defaultLatenessTolerance = 0;
 
     TaskManager() : KPComponent("TaskManager") {}
 
     void init(Config & config) {
-        taskFolder = config.taskFolder;
+        taskFolder               = config.taskFolder;
+        defaultLatenessTolerance = config.latenessTolerance;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Replace the policy used to order due tasks. The policy object must
+     *  outlive the TaskManager. Passing nullptr restores earliest-deadline-first.
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    void setSchedulingPolicy(const SchedulingPolicy * newPolicy) {
+        policy = newPolicy;
+    }
+
+    const SchedulingPolicy & schedulingPolicy() const {
+        return policy ? *policy : defaultPolicy;
+    }
+
+    SchedulingKey schedulingKey(const Task & task) const {
+        SchedulingKey key;
+        key.schedule  = task.schedule;
+        key.priority  = task.priority;
+        key.tolerance = task.latenessTolerance < 0 ? defaultLatenessTolerance
+                                                   : task.latenessTolerance;
+        return key;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Check if the task is too late to be started according to the policy
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool isMissed(const Task & task, long time) const {
+        return schedulingPolicy().isMissed(schedulingKey(task), time);
     }
 
     int generateTaskId() const {
@@ -45,21 +80,48 @@ public:
         return tasks;
     }
 
-    bool advanceTask(int id) {
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Move the task past the valves it just sampled and compute its next
+     *  schedule. Marks the task as completed after the last valve.
+     *
+     *  @param id Id of the task
+     *  @param count Number of valves sampled in the cycle (default: 1)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool advanceTask(int id, int count = 1) {
         if (!findTask(id)) {
             return false;
         }
 
         auto & task = tasks[id];
         println(GREEN("Task Time betwen: "), task.timeBetween);
-        task.schedule = now() + std::max(task.timeBetween, 5);
-        if (++task.valveOffsetStart >= task.getNumberOfValves()) {
+        task.schedule = task.recurrence.nextSchedule(task.timeBetween, now());
+        task.valveOffsetStart += std::max(count, 1);
+        if (task.valveOffsetStart >= task.getNumberOfValves()) {
             return markTaskAsCompleted(id);
         }
 
         return true;
     }
 
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Move a recurring task past an occurrence it missed. The task stays active
+     *  with its remaining valves.
+     *
+     *  @param id Id of the task
+     *  @param time Current time
+     *  @return false if the task does not exist or does not recur
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    bool skipMissedOccurrence(int id, long time) {
+        if (!findTask(id) || !tasks[id].recurrence.isEnabled()) {
+            return false;
+        }
+
+        auto & task   = tasks[id];
+        task.schedule = task.recurrence.nextAfter(time);
+        updateObservers(&TaskObserver::taskDidUpdate, task);
+        return true;
+    }
+
     bool setTaskStatus(int id, TaskStatus status) {
         if (tasks.find(id) == tasks.end()) {
             return false;
@@ -81,8 +143,8 @@ public:
             return false;
         }
 
-        updateObservers(&TaskObserver::taskDidComplete);
         auto & task = tasks[id];
+        updateObservers(&TaskObserver::taskDidComplete, task);
         task.valves.clear();
         if (task.deleteOnCompletion) {
             println("DELETED: ", id);
@@ -154,11 +216,14 @@ public:
     }
 
     /** ────────────────────────────────────────────────────────────────────────────
-     *  @brief Get the Active Task Ids sorted by their schedules (<)
+     *  @brief Get the Active Task Ids in the order they should run. Tasks that are
+     *  due come first in scheduling policy order, followed by upcoming tasks sorted
+     *  by their schedules (<)
      *
+     *  @param time Time used to decide which tasks are due (default: now())
      *  @return std::vector<int> list of ids
      *  ──────────────────────────────────────────────────────────────────────────── */
-    std::vector<int> getActiveSortedTaskIds() {
+    std::vector<int> getActiveSortedTaskIds(long time = now()) {
         std::vector<int> result;
         result.reserve(tasks.size());
 
@@ -168,8 +233,10 @@ public:
             }
         }
 
-        std::sort(result.begin(), result.end(),
-                  [this](int a, int b) { return tasks[a].schedule < tasks[b].schedule; });
+        const SchedulingPolicy & order = schedulingPolicy();
+        std::sort(result.begin(), result.end(), [this, &order, time](int a, int b) {
+            return order.runsBefore(schedulingKey(tasks[a]), schedulingKey(tasks[b]), time);
+        });
 
         return result;
     }
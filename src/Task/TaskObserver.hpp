@@ -13,7 +13,7 @@ public:
         return "<Unnamed> Task Observer";
     }
 
-    virtual void taskDidUpdate(const Task & task) = 0;
-    virtual void taskDidDelete(int id)            = 0;
-    virtual void taskDidComplete()                = 0;
+    virtual void taskDidUpdate(const Task & task)   = 0;
+    virtual void taskDidDelete(int id)              = 0;
+    virtual void taskDidComplete(const Task & task) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <Task/Recurrence.hpp>
+#include <Task/SchedulingPolicy.hpp>
+
+//
+// ──────────────────────────────────────────────────────────────── I ──────────
+//   :::::: T A S K   P L A N N E R : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────────
+//
+// Dry run of the scheduler: replays App::scheduleNextActiveTask (including the scheduling
+// policy), TaskManager::advanceTask and the TaskStateController phase durations without
+// touching any hardware. This header only depends on the standard library so the same
+// planner can be compiled on the host to check a deployment before the unit is sealed.
+//
+namespace TaskPlanner {
+    struct TaskInput {
+        int id               = 0;
+        SchedulingKey key;  // Schedule, priority and lateness tolerance
+        int timeBetween      = 0;
+        int sampleTime       = 0;  // Seconds until a pipelined task hands off its valves
+        long cycleTime       = 0;  // Seconds from the first phase to STOP (Task::getCycleTime)
+        Recurrence recurrence;
+
+        // Valves run together per cycle (task concurrency bounded by the pump limit)
+        int concurrency = 1;
+        // Next valves start sampling as soon as the previous ones are preserving
+        bool pipelined = false;
+
+        const uint8_t * valves = nullptr;
+        int numberOfValves     = 0;
+        int valveOffsetStart   = 0;
+
+        // True for the task currently being executed. Its schedule is the start of the
+        // running valve so it runs first and is never treated as missed.
+        bool running = false;
+
+        // Task started right after this one completes (0 for none)
+        int successor = 0;
+        // True for a task that only runs as the successor of another one
+        bool waiting = false;
+    };
+
+    struct ValveWindow {
+        int taskId;
+        int valve;
+        long start;
+        long end;
+    };
+
+    struct IdleWindow {
+        long start;
+        long end;
+    };
+
+    struct Plan {
+        std::vector<ValveWindow> valves;
+        std::vector<IdleWindow> idle;
+        std::vector<int> missed;
+        long pumpOnSeconds = 0;
+        long begin         = 0;
+        long end           = 0;
+    };
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Simulate every remaining valve execution of the given tasks
+     *
+     *  Tasks wait in a heap keyed by schedule until they are due, then move to a heap
+     *  ordered by the scheduling policy. Each valve execution costs a constant number of
+     *  heap operations, so the plan is linear in the number of valve executions (times
+     *  the log of the number of active tasks).
+     *
+     *  @param tasks Active tasks
+     *  @param start Time at which the simulation starts (usually now())
+     *  @param policy Policy used by TaskManager to order due tasks
+     *  @return Plan Per-valve timeline, idle windows and missed tasks (a recurring task
+     *  is listed once per occurrence it misses)
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    inline Plan plan(std::vector<TaskInput> tasks, long start, const SchedulingPolicy & policy) {
+        Plan result;
+        result.begin = start;
+
+        size_t executions = 0;
+        for (const auto & task : tasks) {
+            executions += std::max(0, task.numberOfValves - task.valveOffsetStart);
+        }
+
+        result.valves.reserve(executions);
+        result.idle.reserve(executions + 1);
+
+        auto later = [&tasks](size_t a, size_t b) {
+            return tasks[a].key.schedule > tasks[b].key.schedule;
+        };
+        auto worse = [&tasks, &policy](size_t a, size_t b) {
+            return policy.runsBefore(tasks[b].key, tasks[a].key);
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> upcoming(later);
+        std::priority_queue<size_t, std::vector<size_t>, decltype(worse)> due(worse);
+
+        long time         = start;
+        const size_t NONE = tasks.size();
+        size_t chained    = NONE;
+        auto execute = [&](size_t index, long valveStart) {
+            TaskInput & task    = tasks[index];
+            const long valveEnd = valveStart + task.cycleTime;
+            const int batch     = std::max(1, std::min(task.concurrency,
+                                                       task.numberOfValves - task.valveOffsetStart));
+            for (int i = 0; i < batch; i++) {
+                result.valves.push_back(
+                    {task.id, task.valves[task.valveOffsetStart + i], valveStart, valveEnd});
+            }
+
+            result.pumpOnSeconds += (valveEnd - valveStart) * batch;
+            time = valveEnd;
+            task.running = false;
+            task.valveOffsetStart += batch;
+
+            // Same as App::handOffCurrentValves: preservation overlaps the next sampling
+            if (task.pipelined && task.valveOffsetStart < task.numberOfValves) {
+                time              = valveStart + task.sampleTime;
+                task.key.schedule = time;
+                chained           = index;
+                return;
+            }
+
+            // Same as TaskManager::advanceTask
+            task.key.schedule = task.recurrence.nextSchedule(task.timeBetween, valveEnd);
+            if (task.valveOffsetStart < task.numberOfValves) {
+                upcoming.push(index);
+                return;
+            }
+
+            // Same as App::startPendingSuccessor: the successor starts as soon as the
+            // pumps are off
+            for (size_t i = 0; task.successor && i < tasks.size(); i++) {
+                if (tasks[i].id == task.successor && tasks[i].waiting
+                    && tasks[i].valveOffsetStart < tasks[i].numberOfValves) {
+                    tasks[i].waiting = false;
+                    chained          = i;
+                    break;
+                }
+            }
+        };
+
+        // The running task finishes its current valve before anything else is considered
+        for (size_t i = 0; i < tasks.size(); i++) {
+            if (tasks[i].waiting || tasks[i].valveOffsetStart >= tasks[i].numberOfValves) {
+                continue;
+            }
+
+            if (tasks[i].running) {
+                execute(i, std::min(tasks[i].key.schedule, time));
+            } else {
+                upcoming.push(i);
+            }
+        }
+
+        while (chained != NONE || !upcoming.empty() || !due.empty()) {
+            if (chained != NONE) {
+                const size_t next = chained;
+                chained           = NONE;
+                execute(next, time);
+                continue;
+            }
+
+            while (!upcoming.empty() && tasks[upcoming.top()].key.isDue(time)) {
+                due.push(upcoming.top());
+                upcoming.pop();
+            }
+
+            if (due.empty()) {
+                // Nothing to run: idle until the next schedule
+                const long next = tasks[upcoming.top()].key.schedule;
+                result.idle.push_back({time, next});
+                time = next;
+                continue;
+            }
+
+            const size_t next = due.top();
+            due.pop();
+            if (policy.isMissed(tasks[next].key, time)) {
+                // Same as scheduleNextActiveTask: a recurring task skips the occurrence
+                // (TaskManager::skipMissedOccurrence), others are invalidated
+                result.missed.push_back(tasks[next].id);
+                if (tasks[next].recurrence.isEnabled()) {
+                    tasks[next].key.schedule = tasks[next].recurrence.nextAfter(time);
+                    if (tasks[next].key.schedule) {
+                        upcoming.push(next);
+                    }
+                }
+
+                continue;
+            }
+
+            execute(next, time);
+        }
+
+        result.end = time;
+        return result;
+    }
+}  // namespace TaskPlanner
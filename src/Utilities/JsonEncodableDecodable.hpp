@@ -3,6 +3,31 @@
 #include <KPFoundation.hpp>
 #include <ArduinoJson.h>
 
+// ────────────────────────────────────────────────────────────────────────────────
+// ─── SECTION  DOCUMENT SIZES ────────────────────────────────────────────────────
+// ────────────────────────────────────────────────────────────────────────────────
+// Bytes of strings copied into a document (keys read from a stream, char arrays), with
+// their terminators
+constexpr size_t jsonStringSize(const char * string) {
+    size_t size = 1;
+    while (*string++) {
+        size++;
+    }
+
+    return size;
+}
+
+template <typename... Strings>
+constexpr size_t jsonStringSize(const char * string, Strings... rest) {
+    return jsonStringSize(string) + jsonStringSize(rest...);
+}
+
+// Object with the given keys: its slots and the copies of its keys
+template <typename... Keys>
+constexpr size_t jsonObjectSize(Keys... keys) {
+    return JSON_OBJECT_SIZE(sizeof...(keys)) + jsonStringSize(keys...);
+}
+
 // ────────────────────────────────────────────────────────────────────────────────
 // ─── SECTION  INTERFACE FOR CUSTOM JSON DECODING OBJECT ─────────────────────────
 // ────────────────────────────────────────────────────────────────────────────────
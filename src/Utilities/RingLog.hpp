@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// ──────────────────────────────────────────────────────────── I ──────────
+//   :::::: R I N G   L O G : :  :   :    :     :        :          :
+// ──────────────────────────────────────────────────────────────────────
+//
+// Fixed-size log of the last N records; the oldest ones are overwritten once it is full.
+// Also counts the newest records not saved to SD yet, and the unsaved records that were
+// overwritten before they could be saved.
+//
+template <typename T, size_t N>
+class RingLog {
+private:
+    std::array<T, N> records;
+    size_t head      = 0;  // Next slot to write
+    size_t count     = 0;
+    size_t unsaved   = 0;
+    uint32_t dropped = 0;
+
+public:
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    void push(const T & record) {
+        records[head] = record;
+        head          = (head + 1) % N;
+        count         = count < N ? count + 1 : N;
+        if (unsaved == N) {
+            dropped++;
+        } else {
+            unsaved++;
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t numberOfUnsaved() const {
+        return unsaved;
+    }
+
+    uint32_t numberOfDropped() const {
+        return dropped;
+    }
+
+    void markSaved() {
+        unsaved = 0;
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Visit the records from the oldest to the newest
+     *
+     *  @param last Only visit the newest `last` records
+     *  @param visit Called with each record
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename Visitor>
+    void forEach(size_t last, Visitor && visit) const {
+        const size_t end = head;
+        const size_t n   = last < count ? last : count;
+        for (size_t i = 0; i < n; i++) {
+            visit(records[(end + N - n + i) % N]);
+        }
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor && visit) const {
+        forEach(count, visit);
+    }
+
+    /** ────────────────────────────────────────────────────────────────────────────
+     *  @brief Visit the records not saved yet, from the oldest to the newest, and
+     *  mark them saved
+     *  ──────────────────────────────────────────────────────────────────────────── */
+    template <typename Visitor>
+    void forEachUnsaved(Visitor && visit) {
+        forEach(unsaved, visit);
+        unsaved = 0;
+    }
+};